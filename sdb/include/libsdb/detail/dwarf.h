@@ -179,6 +179,15 @@ enum {
     DW_DEFAULTED_out_of_class = 0x02,
 };
 
+/* DWARF5 name index attributes, for .debug_names */
+enum {
+    DW_IDX_compile_unit = 1,
+    DW_IDX_type_unit = 2,
+    DW_IDX_die_offset = 3,
+    DW_IDX_parent = 4,
+    DW_IDX_type_hash = 5,
+};
+
 enum {
     DW_FORM_addr = 0x01,
     DW_FORM_block2 = 0x03,
@@ -18,8 +18,18 @@ namespace sdb
             process* process_;
 
         public:
+            struct instruction_layout
+            {
+                std::size_t length;
+                bool is_call;
+                bool is_absolute_branch;
+                std::optional<std::size_t> rip_displacement_offset;
+            };
+
             disassembler(process& proc): process_(&proc) {}
             std::vector<instruction> disassemble(std::size_t n_instructions, std::optional<virt_addr> address = std::nullopt);
+
+            static std::optional<instruction_layout> decode_layout(span<const std::byte> code);
     };
 }
 
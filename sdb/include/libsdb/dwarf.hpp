@@ -5,7 +5,11 @@
 #include <libsdb/types.hpp>
 #include <libsdb/registers.hpp>
 #include <unordered_map>
+#include <map>
+#include <array>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <filesystem>
@@ -18,6 +22,7 @@ namespace sdb
     class compile_unit;
     class process;
     class type;
+    class index_cache;
 
     class range_list 
     {
@@ -125,6 +130,8 @@ namespace sdb
             {}
 
             result eval(const sdb::process& proc, const registers& regs, bool push_cfa = false) const;
+
+            span<const std::byte> data() const { return expr_data_; }
     };
 
     class location_list 
@@ -182,6 +189,8 @@ namespace sdb
     {
         std::uint64_t attr;
         std::uint64_t form;
+        std::int8_t fixed_size;
+        std::int32_t fixed_offset;
     };
 
     struct abbrev
@@ -189,7 +198,35 @@ namespace sdb
         std::uint64_t code;
         std::uint64_t tag;
         bool has_children;
-        std::vector<attr_spec> attr_specs;
+        std::int64_t fixed_size;
+        std::int32_t sibling_index;
+        span<const attr_spec> attr_specs;
+    };
+
+    class abbrev_table
+    {
+        private:
+
+            std::vector<attr_spec> attr_specs_;
+            std::vector<abbrev> dense_;
+            std::unordered_map<std::uint64_t, abbrev> sparse_;
+
+        public:
+
+            abbrev_table(std::vector<attr_spec> attr_specs, std::vector<abbrev> abbrevs);
+            abbrev_table(const abbrev_table&) = delete;
+            abbrev_table(abbrev_table&&) = default;
+            abbrev_table& operator=(const abbrev_table&) = delete;
+
+            const abbrev* find(std::uint64_t code) const
+            {
+                if (code < dense_.size()) return (dense_[code].code != 0) ? &dense_[code] : nullptr;
+
+                auto it = sparse_.find(code);
+                return (it != sparse_.end()) ? &it->second : nullptr;
+            }
+
+            const abbrev& at(std::uint64_t code) const;
     };
 
     class line_table
@@ -226,6 +263,33 @@ namespace sdb
 
         private:
 
+            struct row
+            {
+                std::uint64_t address;
+                std::uint32_t file_index;
+                std::uint32_t line;
+                std::uint32_t column;
+                std::uint32_t discriminator;
+                std::uint8_t flags;
+            };
+
+            struct sequence
+            {
+                std::uint64_t low;
+                std::uint64_t high;
+                std::uint32_t first_row;
+                std::uint32_t end_row;
+            };
+
+            enum row_flags : std::uint8_t
+            {
+                is_stmt_flag = 1 << 0,
+                basic_block_start_flag = 1 << 1,
+                end_sequence_flag = 1 << 2,
+                prologue_end_flag = 1 << 3,
+                epilogue_begin_flag = 1 << 4
+            };
+
             sdb::span<const std::byte> data_;
             const compile_unit* cu_;
             bool default_is_stmt_;
@@ -234,6 +298,17 @@ namespace sdb
             std::uint8_t opcode_base_;
             std::vector<std::filesystem::path> include_directories_;
             mutable std::vector<file> file_names_;
+            mutable std::vector<row> rows_;
+            mutable std::vector<sequence> sequences_;
+            mutable std::once_flag decode_once_;
+            mutable std::atomic<bool> decoded_ = false;
+
+            void decode() const;
+            void decode_program() const;
+            void push_row(const entry& registers) const;
+
+            friend index_cache;
+            friend dwarf;
     };
 
     struct line_table::entry
@@ -267,7 +342,7 @@ namespace sdb
             using difference_type = std::ptrdiff_t;
             using iterator_category = std::forward_iterator_tag;
 
-            iterator(const line_table* table);
+            iterator(const line_table* table, const line_table::row* pos);
 
             iterator() = default;
             iterator(const iterator&) = default;
@@ -284,12 +359,11 @@ namespace sdb
 
         private:
 
-            const line_table* table_;
+            const line_table* table_ = nullptr;
+            const line_table::row* pos_ = nullptr;
             line_table::entry current_;
-            line_table::entry registers_;
-            const std::byte* pos_;
 
-            bool execute_instruction();
+            void load();
     };
 
     class compile_unit
@@ -299,7 +373,11 @@ namespace sdb
             dwarf* parent_;
             span<const std::byte> data_;
             std::size_t abbrev_offset_;
-            std::unique_ptr<line_table> line_table_;
+            const sdb::abbrev_table* abbrev_table_;
+            mutable std::once_flag line_table_once_;
+            mutable std::unique_ptr<line_table> line_table_;
+
+            friend index_cache;
 
         public:
 
@@ -308,11 +386,11 @@ namespace sdb
             const dwarf* dwarf_info() const { return parent_; }
             span<const std::byte> data() const { return data_; }
 
-            const std::unordered_map<std::uint64_t, sdb::abbrev>& abbrev_table() const;
+            const sdb::abbrev_table& abbrev_table() const { return *abbrev_table_; }
 
             die root() const;
 
-            const line_table& lines() const { return *line_table_; }
+            const line_table& lines() const;
     };
 
     class call_frame_information
@@ -349,6 +427,37 @@ namespace sdb
                 const std::byte* operator[](file_addr address) const;
             };
 
+            struct unwind_rule
+            {
+                enum kind_type : std::uint8_t
+                {
+                    unspecified,
+                    undefined,
+                    same_value,
+                    offset,
+                    val_offset,
+                    in_register,
+                    expression,
+                    val_expression
+                };
+
+                kind_type kind = unspecified;
+                std::int64_t value = 0;
+                span<const std::byte> expr = {};
+            };
+
+            static constexpr std::size_t n_unwind_registers = 17;
+
+            struct unwind_row
+            {
+                std::uint64_t high;
+                bool cfa_is_expression = false;
+                std::uint32_t cfa_register = 0;
+                std::int64_t cfa_offset = 0;
+                span<const std::byte> cfa_expr;
+                std::array<unwind_rule, n_unwind_registers> rules;
+            };
+
             call_frame_information() = delete;
             call_frame_information(const call_frame_information&) = delete;
             call_frame_information& operator=(const call_frame_information&) = delete;
@@ -361,11 +470,21 @@ namespace sdb
 
             registers unwind(const process& proc, file_addr pc, registers& regs) const;
 
+            std::size_t cached_unwinds() const
+            {
+                std::lock_guard lock(unwind_rows_mutex_);
+                return cached_unwinds_;
+            }
+
         private:
 
             const dwarf* dwarf_;
             mutable std::unordered_map<std::uint32_t, common_information_entry> cie_map_;
             eh_hdr eh_hdr_;
+
+            mutable std::mutex unwind_rows_mutex_;
+            mutable std::map<std::uint64_t, unwind_row> unwind_rows_;
+            mutable std::size_t cached_unwinds_ = 0;
     };
 
     class dwarf
@@ -373,7 +492,7 @@ namespace sdb
         private:
 
             const elf* elf_;
-            std::unordered_map<std::size_t, std::unordered_map<std::uint64_t, abbrev>> abbrev_tables_;
+            std::unordered_map<std::size_t, abbrev_table> abbrev_tables_;
             std::vector<std::unique_ptr<compile_unit>> compile_units_;
             std::unique_ptr<call_frame_information> cfi_;
 
@@ -388,15 +507,93 @@ namespace sdb
 
             mutable std::unordered_map<const std::byte*, index_entry> member_function_index_;
 
+            struct partial_index
+            {
+                std::vector<std::pair<std::string_view, index_entry>> functions;
+                std::vector<std::pair<std::string_view, index_entry>> global_variables;
+                std::vector<std::pair<const std::byte*, index_entry>> member_functions;
+            };
+
+            mutable std::once_flag index_once_;
+            mutable std::atomic<bool> indexed_ = false;
+
+            struct function_range
+            {
+                std::uint64_t high;
+                index_entry entry;
+            };
+
+            mutable std::vector<std::uint64_t> function_range_starts_;
+            mutable std::vector<function_range> function_ranges_;
+
+            struct compile_unit_range
+            {
+                std::uint64_t high;
+                const compile_unit* cu;
+            };
+
+            mutable std::vector<std::uint64_t> compile_unit_range_starts_;
+            mutable std::vector<compile_unit_range> compile_unit_ranges_;
+            mutable std::once_flag compile_unit_ranges_once_;
+
+            enum accelerator_kind : std::uint8_t
+            {
+                accelerated_function = 1,
+                accelerated_variable = 2
+            };
+
+            struct accelerator_entry
+            {
+                std::uint32_t cu;
+                std::uint8_t kinds;
+                const std::byte* die = nullptr;
+            };
+
+            struct compile_unit_index
+            {
+                std::once_flag once;
+                partial_index index;
+            };
+
+            mutable std::once_flag accelerator_once_;
+            mutable bool has_accelerator_ = false;
+            mutable std::unordered_multimap<std::string_view, accelerator_entry> accelerator_index_;
+            mutable std::vector<std::uint32_t> unaccelerated_compile_units_;
+            mutable std::unique_ptr<compile_unit_index[]> compile_unit_indexes_;
+
+            struct line_index_file
+            {
+                const line_table* table;
+                std::size_t cu_index;
+                const line_table::file* file;
+                std::vector<std::pair<std::uint32_t, std::uint32_t>> rows_by_line;
+            };
+
+            mutable std::once_flag line_index_once_;
+            mutable std::unordered_map<std::string, std::vector<line_index_file>> line_index_;
+
+            friend index_cache;
+
             void index() const;
-            void index_die(const die& current, bool in_function = false) const;
+            void build_line_index() const;
+            const std::byte* index_die(const die& current, partial_index& index, bool in_function = false) const;
+            void build_function_ranges() const;
+            void build_compile_unit_ranges() const;
+            std::optional<std::size_t> find_compile_unit_at_offset(std::uint64_t offset) const;
+
+            bool load_accelerator() const;
+            bool load_gdb_index(span<const std::byte> data) const;
+            bool load_debug_names(span<const std::byte> data) const;
+            std::vector<std::uint32_t> accelerated_compile_units(std::string_view name, std::uint8_t kind) const;
+            std::vector<die> accelerated_dies(std::string_view name, std::uint8_t kind) const;
+            const partial_index& compile_unit_index_at(std::size_t index) const;
 
         public:
 
             dwarf(const elf& parent);
             const elf* elf_file() const { return elf_; }
 
-            const std::unordered_map<std::uint64_t, abbrev>& get_abbrev_table(std::size_t offset);
+            const abbrev_table& get_abbrev_table(std::size_t offset);
             const std::vector<std::unique_ptr<compile_unit>>& compile_units() const { return compile_units_; }
 
             const compile_unit* compile_unit_containing_address(file_addr address) const;
@@ -413,6 +610,8 @@ namespace sdb
                 return cu->lines().get_entry_by_address(address);
             }
 
+            std::vector<line_table::iterator> get_line_entries_by_line(std::filesystem::path path, std::size_t line) const;
+
             std::vector<die> inline_stack_at_address(file_addr address) const;
 
             const call_frame_information& cfi() const { return *cfi_; }
@@ -437,13 +636,15 @@ namespace sdb
             const compile_unit* cu_ = nullptr;
             const abbrev* abbrev_ = nullptr;
             const std::byte* next_ = nullptr;
-            std::vector<const std::byte*> attr_locs_;
+
+            const std::byte* attribute_location(std::size_t index) const;
+            const std::byte* sibling_position() const;
 
         public:
 
             explicit die(const std::byte* next): next_(next) {}
-            die(const std::byte* pos, const compile_unit* cu, const abbrev* abbrev, std::vector<const std::byte*> attr_locs, const std::byte* next):
-                pos_(pos), cu_(cu), abbrev_(abbrev), attr_locs_(std::move(attr_locs)), next_(next) {}
+            die(const std::byte* pos, const compile_unit* cu, const abbrev* abbrev, const std::byte* next):
+                pos_(pos), cu_(cu), abbrev_(abbrev), next_(next) {}
 
             const compile_unit* cu() const { return cu_; }
             const abbrev* abbrev_entry() const { return abbrev_; }
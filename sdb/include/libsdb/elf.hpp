@@ -7,12 +7,15 @@
 #include <unordered_map>
 #include <optional>
 #include <map>
+#include <deque>
+#include <string>
 #include <string_view>
 #include <libsdb/types.hpp>
 
 namespace sdb
 {
     class dwarf; 
+    class index_cache;
 
     class elf 
     {
@@ -34,8 +37,12 @@ namespace sdb
             std::vector<Elf64_Sym> symbol_table_;
             std::unordered_multimap<std::string_view, Elf64_Sym*> symbol_name_map_;
             std::map<std::pair<file_addr, file_addr>, Elf64_Sym*, range_comparator> symbol_addr_map_;
+            std::deque<std::string> demangled_names_;
+            std::unique_ptr<index_cache> cache_;
             std::unique_ptr<dwarf> dwarf_;
 
+            friend index_cache;
+
             void parse_section_headers();
             void build_section_map();
             void parse_symbol_table();
@@ -51,6 +58,8 @@ namespace sdb
 
             std::filesystem::path path() const { return path_; }
             const Elf64_Ehdr& get_header() const { return header_; }
+            std::optional<std::string> build_id() const;
+            const index_cache* get_index_cache() const { return cache_.get(); }
 
             std::string_view get_section_name(std::size_t index) const;
             std::optional<const Elf64_Shdr*> get_section(std::string_view name) const;
@@ -0,0 +1,65 @@
+#ifndef SDB_EVENT_LOOP_HPP
+#define SDB_EVENT_LOOP_HPP
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include <signal.h>
+
+namespace sdb
+{
+    class process;
+    struct stop_reason;
+
+    // Multiplexes inferior state changes with other file descriptors.
+    // Ptrace stops are noticed through SIGCHLD, read from a signalfd; each
+    // watched process's pidfd only becomes readable once it exits.
+    // SIGCHLD is blocked for the calling thread while the loop exists,
+    // so other threads in the debugger should block it as well.
+    class event_loop
+    {
+        public:
+            event_loop();
+            ~event_loop();
+
+            event_loop(const event_loop&) = delete;
+            event_loop& operator=(const event_loop&) = delete;
+
+            void watch(process& proc, std::function<void(const stop_reason&)> on_stop);
+            void unwatch(process& proc);
+
+            void add_fd(int fd, std::function<void()> on_ready);
+            void remove_fd(int fd);
+
+            int add_timer(std::chrono::nanoseconds interval, std::function<void()> on_tick);
+            void remove_timer(int timer_fd);
+
+            std::size_t run_once(std::optional<std::chrono::milliseconds> timeout = std::nullopt);
+            void run();
+            void stop() { stopping_ = true; }
+
+        private:
+            struct watched_process
+            {
+                process* proc;
+                int pidfd;
+                std::function<void(const stop_reason&)> on_stop;
+            };
+
+            void drain_signals();
+            std::size_t drain_process_events();
+
+            int epoll_fd_ = -1;
+            int signal_fd_ = -1;
+            sigset_t old_mask_;
+            std::unordered_map<int, std::function<void()>> handlers_;
+            std::vector<watched_process> processes_;
+            std::vector<int> timers_;
+            bool needs_drain_ = false;
+            bool stopping_ = false;
+    };
+}
+
+#endif
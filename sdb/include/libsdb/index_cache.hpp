@@ -0,0 +1,51 @@
+#ifndef SDB_INDEX_CACHE_HPP
+#define SDB_INDEX_CACHE_HPP
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <cstddef>
+#include <libsdb/types.hpp>
+
+namespace sdb
+{
+    class elf;
+    class dwarf;
+    class compile_unit;
+    class line_table;
+
+    class index_cache
+    {
+        public:
+
+            index_cache() = delete;
+            index_cache(const index_cache&) = delete;
+            index_cache& operator=(const index_cache&) = delete;
+            ~index_cache();
+
+            static void set_directory(std::optional<std::filesystem::path> directory);
+            static std::optional<std::filesystem::path> directory();
+
+            static std::unique_ptr<index_cache> open(const elf& obj);
+            static void store(const elf& obj);
+
+            void load_symbols(elf& obj) const;
+            void load_dwarf(const dwarf& dwarf_info) const;
+            void load_line_table(const compile_unit& cu, const line_table& lines) const;
+
+        private:
+
+            index_cache(int fd, std::byte* data, std::size_t size): fd_(fd), data_(data), size_(size) {}
+
+            template <class T> span<const T> table(std::size_t index) const;
+            static std::vector<std::size_t> record_sizes();
+            bool records_valid(const elf& obj) const;
+
+            int fd_;
+            std::byte* data_;
+            std::size_t size_;
+    };
+}
+
+#endif
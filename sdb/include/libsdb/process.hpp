@@ -22,7 +22,7 @@ namespace sdb
 
     enum class trap_type
     {
-        single_step, software_break, hardware_break, syscall, clone, unknown
+        single_step, software_break, hardware_break, syscall, clone, interrupt, unknown
     };
 
     enum class process_state 
@@ -111,7 +111,8 @@ namespace sdb
         registers regs;
         stop_reason reason;
         process_state state = process_state::stopped;
-        bool pending_sigstop = false;
+        bool pending_interrupt = false;
+        bool registers_stale = false;
     };
 
     class process
@@ -128,7 +129,13 @@ namespace sdb
             static std::unique_ptr<process> attach(pid_t pid);
 
             void resume(std::optional<pid_t> otid = std::nullopt);
+            void interrupt(std::optional<pid_t> otid = std::nullopt);
             stop_reason wait_on_signal(pid_t to_await = -1);
+
+            // Only collects events of this process's own threads, so several
+            // inferiors can be polled side by side
+            std::optional<stop_reason> poll_signal();
+            bool has_pending_stops() const;
             pid_t pid() const { return pid_; }
             process_state state() const { return state_; }
 
@@ -167,6 +174,23 @@ namespace sdb
             std::vector<std::byte> read_memory_without_traps(virt_addr address, std::size_t amount) const;
             void write_memory(virt_addr address, span<const std::byte> data);
 
+            struct memory_read_request
+            {
+                virt_addr address;
+                std::size_t size;
+            };
+
+            // data holds the readable prefix of the request; error is the errno that cut it short
+            struct memory_read_result
+            {
+                std::vector<std::byte> data;
+                int error = 0;
+
+                bool ok() const { return error == 0; }
+            };
+
+            std::vector<memory_read_result> read_memory_batch(span<const memory_read_request> requests) const;
+
             template <class T>
             T read_memory_as(virt_addr address) const
             {
@@ -174,7 +198,27 @@ namespace sdb
                 return from_bytes<T>(data.data());
             }
 
-            std::string read_string(virt_addr address) const;
+            // Stops at the terminator, after max_length bytes, or at the first unreadable page
+            std::string read_string(virt_addr address, std::size_t max_length = default_max_string_length) const;
+            static constexpr std::size_t default_max_string_length = 0x10000;
+
+            void snapshot_stack(std::optional<pid_t> otid = std::nullopt);
+
+            struct memory_cache_statistics
+            {
+                std::size_t hits = 0;
+                std::size_t misses = 0;
+            };
+
+            void set_memory_cache(bool enabled) { memory_cache_enabled_ = enabled; invalidate_memory_caches(); }
+            bool memory_cache() const { return memory_cache_enabled_; }
+            const memory_cache_statistics& memory_cache_stats() const { return memory_cache_stats_; }
+
+            void invalidate_memory_caches()
+            {
+                stack_snapshots_.clear();
+                memory_pages_.clear();
+            }
 
             std::variant<breakpoint_site::id_type, watchpoint::id_type> get_current_hardware_stoppoint(std::optional<pid_t> otid = std::nullopt) const;
 
@@ -187,6 +231,14 @@ namespace sdb
 
             void set_target(target* tgt) { target_ = tgt; }
 
+            void set_non_stop(bool non_stop) { non_stop_ = non_stop; }
+            bool non_stop() const { return non_stop_; }
+
+            void set_displaced_stepping(bool enabled) { displaced_stepping_ = enabled; }
+            bool displaced_stepping() const { return displaced_stepping_; }
+
+            pid_t memory_access_tid() const;
+
             void set_current_thread(pid_t tid) { current_thread_ = tid; }
             pid_t current_thread() const { return current_thread_; }
 
@@ -226,9 +278,51 @@ namespace sdb
 
             void populate_existing_threads();
 
-            void swallow_pending_sigstop(pid_t tid);
+            struct stack_snapshot
+            {
+                virt_addr start;
+                std::vector<std::byte> data;
+                bool at_end = false;
+            };
+
+            bool memory_is_stable() const;
+            const std::byte* find_in_stack_snapshots(virt_addr address, std::size_t amount) const;
+            bool extend_stack_snapshot(stack_snapshot& snapshot, std::size_t needed) const;
+            bool read_cached_pages(virt_addr address, std::byte* dest, std::size_t amount) const;
+
+            std::optional<stop_reason> wait_for_stop(pid_t to_await, int options);
+            std::optional<stop_reason> handle_wait_status(pid_t tid, int wait_status, pid_t& to_await);
+            std::optional<stop_reason> report_stop(stop_reason reason, pid_t& to_await);
+            void defer_stop(pid_t tid, int wait_status);
+            bool has_pending_stop(pid_t tid) const;
+            bool owns_thread(pid_t tid) const;
+            pid_t poll_threads(int& wait_status, int options);
+            void track_new_thread(pid_t parent);
+
+            std::vector<pid_t> pause_other_threads(pid_t tid);
+            void resume_paused_threads(const std::vector<pid_t>& paused);
+
+            struct displaced_step
+            {
+                pid_t tid;
+                virt_addr from;
+                virt_addr slot;
+                std::size_t length;
+                bool is_call;
+                bool is_absolute_branch;
+            };
+
+            std::optional<virt_addr> displaced_step_area(pid_t tid);
+            std::optional<displaced_step> prepare_displaced_step(pid_t tid, std::size_t slot_index);
+            void finish_displaced_step(const displaced_step& step);
+
+            int memory_file();
+
+            int wait_for_single_step(pid_t tid, bool& interrupted);
+            void swallow_pending_interrupt(pid_t tid);
             void send_continue(pid_t tid);
             void step_over_breakpoint(pid_t tid);
+            void step_over_breakpoints(const std::vector<pid_t>& tids);
 
             pid_t pid_ = 0;
             bool terminate_on_end_ = true;
@@ -238,10 +332,21 @@ namespace sdb
             stoppoint_collection<watchpoint> watchpoints_;
             syscall_catch_policy syscall_catch_policy_ = syscall_catch_policy::catch_none();
             bool expecting_syscall_exit_ = false;
+            bool non_stop_ = false;
+            bool displaced_stepping_ = true;
+            bool displaced_step_area_failed_ = false;
+            std::optional<virt_addr> displaced_step_area_;
+            int memory_fd_ = -1;
+            std::vector<stop_reason> pending_stops_;
+            std::vector<pid_t> announced_threads_;
             target* target_ = nullptr;
             std::unordered_map<pid_t, thread_state> threads_;
             pid_t current_thread_ = 0;
             std::function<void(const stop_reason&)> thread_lifecycle_callback_;
+            mutable std::vector<stack_snapshot> stack_snapshots_;
+            bool memory_cache_enabled_ = false;
+            mutable std::unordered_map<std::uint64_t, std::vector<std::byte>> memory_pages_;
+            mutable memory_cache_statistics memory_cache_stats_;
     };
 }
 
@@ -0,0 +1,70 @@
+#ifndef SDB_PROFILER_HPP
+#define SDB_PROFILER_HPP
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <libsdb/dwarf.hpp>
+#include <libsdb/types.hpp>
+
+namespace sdb
+{
+    class target;
+
+    class profiler
+    {
+        public:
+
+            struct statistics
+            {
+                std::size_t n_ticks = 0;
+                std::size_t n_samples = 0;
+                std::chrono::nanoseconds total_stop_time{0};
+                std::chrono::nanoseconds max_stop_time{0};
+            };
+
+            explicit profiler(target& tgt, std::size_t ring_capacity = 1024);
+
+            profiler(const profiler&) = delete;
+            profiler& operator=(const profiler&) = delete;
+
+            bool sample();
+            void run(std::chrono::nanoseconds interval, std::chrono::nanoseconds duration);
+
+            std::string folded_stacks();
+            const statistics& stats() const { return stats_; }
+
+        private:
+
+            // Names are resolved when sampling, since a DIE may not outlive its library being unloaded
+            struct sample_frame
+            {
+                const std::string* name;
+            };
+
+            struct call_tree_node
+            {
+                std::string name;
+                std::size_t count = 0;
+                std::map<std::string, std::size_t> children;
+            };
+
+            void flush();
+            std::size_t child(std::size_t parent, const std::string& name);
+            const std::string& frame_name(virt_addr pc, const die& func, bool inlined);
+            void write_folded(std::size_t node, std::string& prefix, std::string& out) const;
+
+            target* target_;
+            std::vector<std::vector<sample_frame>> ring_;
+            std::size_t ring_head_ = 0;
+            std::size_t ring_size_ = 0;
+            std::vector<call_tree_node> nodes_;
+            std::unordered_map<std::uint64_t, std::string> symbol_names_;
+            std::map<std::string, std::string, std::less<>> inlined_names_;
+            statistics stats_;
+    };
+}
+
+#endif
@@ -10,6 +10,11 @@ namespace sdb
 {
     class target;
 
+    enum class unwind_mode
+    {
+        precise, frame_pointer
+    };
+
     struct stack_frame
     {
         registers regs;
@@ -25,13 +30,20 @@ namespace sdb
 
             target* target_ = nullptr;
             std::uint32_t inline_height_ = 0;
-            std::vector<stack_frame> frames_;
+            mutable std::vector<stack_frame> frames_;
+            mutable registers next_regs_;
+            mutable file_addr next_pc_;
+            mutable bool complete_ = false;
             std::size_t current_frame_ = 0;
             pid_t tid_ = 0;
 
-            void create_inline_stack_frames(const sdb::registers& regs, const std::vector<sdb::die> inline_stack, file_addr pc);
+            void unwind_frames(std::size_t count) const;
+
+            void create_inline_stack_frames(const sdb::registers& regs, const std::vector<sdb::die> inline_stack, file_addr pc) const;
+
+            void create_base_frame(const sdb::registers& regs, const std::vector<sdb::die> inline_stack, file_addr pc, bool inlined) const;
 
-            void create_base_frame(const sdb::registers& regs, const std::vector<sdb::die> inline_stack, file_addr pc, bool inlined);
+            bool unwind_frame_pointer(sdb::registers& frame_regs, sdb::registers& unwound) const;
 
         public:
 
@@ -47,13 +59,15 @@ namespace sdb
                 current_frame_ = inline_height_;
             }
 
+            void invalidate();
             void unwind();
             void up() { ++current_frame_; }
             void down() { --current_frame_; }
 
             span<const stack_frame> frames() const;
-            bool has_frames() const { return !frames_.empty(); }
-            const stack_frame& current_frame() const { return frames_[current_frame_]; }
+            const stack_frame& frame(std::size_t index) const;
+            bool has_frames() const;
+            const stack_frame& current_frame() const;
             std::size_t current_frame_index() const { return current_frame_ - inline_height_; }
 
             const registers& regs() const;
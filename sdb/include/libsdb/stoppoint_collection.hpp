@@ -2,6 +2,8 @@
 #define SDB_STOPPOINT_COLLECTION_HPP
 
 #include <vector>
+#include <map>
+#include <unordered_map>
 #include <memory>
 #include <algorithm>
 #include <type_traits>
@@ -10,6 +12,16 @@
 
 namespace sdb
 {
+    namespace detail
+    {
+        // Stoppoints whose address is fixed at creation can be indexed by it
+        template <class T, class = void>
+        struct has_fixed_address : std::false_type {};
+
+        template <class T>
+        struct has_fixed_address<T, std::void_t<decltype(std::declval<const T&>().address())>> : std::true_type {};
+    }
+
     template <class Stoppoint, bool Owning = true>
     class stoppoint_collection 
     {
@@ -42,70 +54,112 @@ namespace sdb
 
         private:
 
-            using points_t = std::vector<pointer_type>;
+            static constexpr bool indexed_by_address = detail::has_fixed_address<Stoppoint>::value;
+
+            // Keyed by a creation sequence number, so iteration follows creation order and
+            // removal needs no scan
+            using points_t = std::map<std::uint64_t, pointer_type>;
             points_t stoppoints_;
+            std::uint64_t next_sequence_ = 0;
+            std::unordered_map<const Stoppoint*, std::uint64_t> sequences_;
+
+            // Ids and addresses need not be unique, so each key keeps its stoppoints in insertion order
+            std::unordered_map<typename Stoppoint::id_type, std::vector<Stoppoint*>> by_id_;
+            std::unordered_map<std::uint64_t, std::vector<Stoppoint*>> by_address_;
+            std::multimap<std::uint64_t, Stoppoint*> by_ordered_address_;
 
-            typename points_t::iterator find_by_id(typename Stoppoint::id_type id);
-            typename points_t::const_iterator find_by_id(typename Stoppoint::id_type id) const;
-            typename points_t::iterator find_by_address(virt_addr address);
-            typename points_t::const_iterator find_by_address(virt_addr address) const;
+            Stoppoint* find_by_id(typename Stoppoint::id_type id) const;
+            Stoppoint* find_by_address(virt_addr address) const;
+            void erase(Stoppoint* point);
     };
 
     template <class Stoppoint, bool Owning>
     Stoppoint& stoppoint_collection<Stoppoint,Owning>::push(pointer_type bs)
     {
-        stoppoints_.push_back(std::move(bs));
-        return *stoppoints_.back();
-    }
+        auto point = &*bs;
+        auto sequence = next_sequence_++;
+        stoppoints_.emplace(sequence, std::move(bs));
+        sequences_.emplace(point, sequence);
 
-    template <class Stoppoint, bool Owning>
-    auto stoppoint_collection<Stoppoint,Owning>::find_by_id(typename Stoppoint::id_type id) -> typename points_t::iterator
-    {
-        return std::find_if(begin(stoppoints_), end(stoppoints_), [=](auto& point) { return (point->id() == id); });
+        by_id_[point->id()].push_back(point);
+        if constexpr (indexed_by_address)
+        {
+            by_address_[point->address().addr()].push_back(point);
+            by_ordered_address_.emplace(point->address().addr(), point);
+        }
+        return *point;
     }
 
     template <class Stoppoint, bool Owning>
-    auto stoppoint_collection<Stoppoint,Owning>::find_by_id(typename Stoppoint::id_type id) const -> typename points_t::const_iterator
+    Stoppoint* stoppoint_collection<Stoppoint,Owning>::find_by_id(typename Stoppoint::id_type id) const
     {
-        return const_cast<stoppoint_collection*>(this)->find_by_id(id);
+        auto it = by_id_.find(id);
+        return (it == by_id_.end()) ? nullptr : it->second.front();
     }
 
     template <class Stoppoint, bool Owning>
-    auto stoppoint_collection<Stoppoint,Owning>::find_by_address(virt_addr address) -> typename points_t::iterator
+    Stoppoint* stoppoint_collection<Stoppoint,Owning>::find_by_address(virt_addr address) const
     {
-        return std::find_if(begin(stoppoints_), end(stoppoints_), [=](auto& point) { return point->at_address(address); });
+        if constexpr (indexed_by_address)
+        {
+            auto it = by_address_.find(address.addr());
+            return (it == by_address_.end()) ? nullptr : it->second.front();
+
+        } else {
+
+            auto it = std::find_if(begin(stoppoints_), end(stoppoints_), [=](auto& entry) { return entry.second->at_address(address); });
+            return (it == end(stoppoints_)) ? nullptr : &*it->second;
+        }
     }
 
     template <class Stoppoint, bool Owning>
-    auto stoppoint_collection<Stoppoint,Owning>::find_by_address(virt_addr address) const -> typename points_t::const_iterator
+    void stoppoint_collection<Stoppoint,Owning>::erase(Stoppoint* point)
     {
-        return const_cast<stoppoint_collection*>(this)->find_by_address(address);
+        auto unindex = [point](auto& index, auto key) {
+            auto& bucket = index.at(key);
+            bucket.erase(std::find(begin(bucket), end(bucket), point));
+            if (bucket.empty()) index.erase(key);
+        };
+
+        unindex(by_id_, point->id());
+        if constexpr (indexed_by_address)
+        {
+            unindex(by_address_, point->address().addr());
+
+            auto [first, last] = by_ordered_address_.equal_range(point->address().addr());
+            by_ordered_address_.erase(std::find_if(first, last, [=](auto& entry) { return entry.second == point; }));
+        }
+
+        auto sequence = sequences_.find(point);
+        stoppoints_.erase(sequence->second);
+        sequences_.erase(sequence);
     }
 
     template <class Stoppoint, bool Owning>
     bool stoppoint_collection<Stoppoint,Owning>::contains_id(typename Stoppoint::id_type id) const
     {
-        return (find_by_id(id) != end(stoppoints_));
+        return (find_by_id(id) != nullptr);
     }
 
     template <class Stoppoint, bool Owning>
     bool stoppoint_collection<Stoppoint,Owning>::contains_address(virt_addr address) const
     {
-        return (find_by_address(address) != end(stoppoints_));
+        return (find_by_address(address) != nullptr);
     }
 
     template <class Stoppoint, bool Owning>
     bool stoppoint_collection<Stoppoint,Owning>::enabled_stoppoint_at_address(virt_addr address) const
     {
-        return (contains_address(address) and get_by_address(address).is_enabled());
+        auto point = find_by_address(address);
+        return (point and point->is_enabled());
     }
 
     template <class Stoppoint, bool Owning>
     Stoppoint& stoppoint_collection<Stoppoint,Owning>::get_by_id(typename Stoppoint::id_type id)
     {
-        auto it = find_by_id(id);
-        if (it == end(stoppoints_)) error::send("Invalid stoppoint id");
-        return **it;
+        auto point = find_by_id(id);
+        if (!point) error::send("Invalid stoppoint id");
+        return *point;
     }
 
     template <class Stoppoint, bool Owning>
@@ -117,9 +171,9 @@ namespace sdb
     template <class Stoppoint, bool Owning>
     Stoppoint& stoppoint_collection<Stoppoint,Owning>::get_by_address(virt_addr address)
     {
-        auto it = find_by_address(address);
-        if (it == end(stoppoints_)) error::send("Stoppoint with given address not found");
-        return **it;
+        auto point = find_by_address(address);
+        if (!point) error::send("Stoppoint with given address not found");
+        return *point;
     }
 
     template <class Stoppoint, bool Owning>
@@ -132,11 +186,25 @@ namespace sdb
     std::vector<Stoppoint*> stoppoint_collection<Stoppoint,Owning>::get_in_region(virt_addr low, virt_addr high) const
     {
         std::vector<Stoppoint*> ret;
-        for (auto& site: stoppoints_)
+        if constexpr (indexed_by_address)
         {
-            if (site->in_range(low, high))
+            if (low.addr() >= high.addr()) return ret;
+
+            auto first = by_ordered_address_.lower_bound(low.addr());
+            auto last = by_ordered_address_.lower_bound(high.addr());
+            for (auto it = first; it != last; ++it) ret.push_back(it->second);
+
+            // Reported in creation order, the same as the unindexed scan
+            std::sort(begin(ret), end(ret), [this](auto lhs, auto rhs) { return sequences_.at(lhs) < sequences_.at(rhs); });
+
+        } else {
+
+            for (auto& [_, site]: stoppoints_)
             {
-                ret.push_back(&*site);
+                if (site->in_range(low, high))
+                {
+                    ret.push_back(&*site);
+                }
             }
         }
         return ret;
@@ -145,24 +213,24 @@ namespace sdb
     template <class Stoppoint, bool Owning>
     void stoppoint_collection<Stoppoint,Owning>::remove_by_id(typename Stoppoint::id_type id) 
     {
-        auto it = find_by_id(id);
-        (**it).disable();
-        stoppoints_.erase(it);
+        auto& point = get_by_id(id);
+        point.disable();
+        erase(&point);
     }
 
     template <class Stoppoint, bool Owning>
     void stoppoint_collection<Stoppoint,Owning>::remove_by_address(virt_addr address) 
     {
-        auto it = find_by_address(address);
-        (**it).disable();
-        stoppoints_.erase(it);
+        auto& point = get_by_address(address);
+        point.disable();
+        erase(&point);
     }
 
     template <class Stoppoint, bool Owning>
     template <class F>
     void stoppoint_collection<Stoppoint,Owning>::for_each(F f)
     {
-        for (auto& point: stoppoints_)
+        for (auto& [_, point]: stoppoints_)
         {
             f(*point);
         }
@@ -172,7 +240,7 @@ namespace sdb
     template <class F>
     void stoppoint_collection<Stoppoint,Owning>::for_each(F f) const
     {
-        for (const auto& point: stoppoints_)
+        for (const auto& [_, point]: stoppoints_)
         {
             f(*point);
         }
@@ -33,6 +33,7 @@ namespace sdb
             virt_addr dynamic_linker_rendezvous_address_;
             std::unordered_map<pid_t, thread> threads_;
             mutable std::vector<typed_data> expression_results_;
+            sdb::unwind_mode unwind_mode_ = sdb::unwind_mode::precise;
 
             target(std::unique_ptr<process> proc, std::unique_ptr<elf> obj): process_(std::move(proc)), main_elf_(obj.get()) 
             {
@@ -80,6 +81,12 @@ namespace sdb
                 return const_cast<target*>(this)->get_stack(otid); 
             }
 
+            void set_unwind_mode(sdb::unwind_mode mode) { unwind_mode_ = mode; }
+            sdb::unwind_mode get_unwind_mode() const { return unwind_mode_; }
+
+            void set_non_stop(bool non_stop) { process_->set_non_stop(non_stop); }
+            bool non_stop() const { return process_->non_stop(); }
+
             sdb::stop_reason step_in(std::optional<pid_t> otid = std::nullopt);
             sdb::stop_reason step_out(std::optional<pid_t> otid = std::nullopt);
             sdb::stop_reason step_over(std::optional<pid_t> otid = std::nullopt);
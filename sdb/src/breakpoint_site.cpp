@@ -34,7 +34,7 @@ void sdb::breakpoint_site::enable()
     } else {
 
         errno = 0;
-        std::uint64_t data = ptrace(PTRACE_PEEKDATA, process_->pid(), address_, nullptr);
+        std::uint64_t data = ptrace(PTRACE_PEEKDATA, process_->memory_access_tid(), address_, nullptr);
         if (errno != 0)
         {
             error::send_errno("Enabling breakpoint site failed");
@@ -44,10 +44,11 @@ void sdb::breakpoint_site::enable()
 
         std::uint64_t int3 = 0xcc;
         std::uint64_t data_with_int3 = ((data & ~0xff) | int3);
-        if (ptrace(PTRACE_POKEDATA, process_->pid(), address_, data_with_int3) < 0)
+        if (ptrace(PTRACE_POKEDATA, process_->memory_access_tid(), address_, data_with_int3) < 0)
         {
             error::send_errno("Enabling breakpoint site failed");
         }
+        process_->invalidate_memory_caches();
     }
 
     is_enabled_ = true;
@@ -65,17 +66,18 @@ void sdb::breakpoint_site::disable()
     } else {
 
         errno = 0;
-        std::uint64_t data = ptrace(PTRACE_PEEKDATA, process_->pid(), address_, nullptr);
+        std::uint64_t data = ptrace(PTRACE_PEEKDATA, process_->memory_access_tid(), address_, nullptr);
         if (errno != 0)
         {
             error::send_errno("Disabling breakpoint site failed");
         }
 
         auto restored_data = ((data & ~0xff) | static_cast<uint8_t>(saved_data_));
-        if (ptrace(PTRACE_POKEDATA, process_->pid(), address_, restored_data) < 0)
+        if (ptrace(PTRACE_POKEDATA, process_->memory_access_tid(), address_, restored_data) < 0)
         {
             error::send_errno("Disabling breakpoint site failed");
         }
+        process_->invalidate_memory_caches();
     }
 
     is_enabled_ = false;
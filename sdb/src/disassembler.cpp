@@ -24,4 +24,42 @@ std::vector<sdb::disassembler::instruction> sdb::disassembler::disassemble(std::
     }
 
     return ret;
+}
+
+std::optional<sdb::disassembler::instruction_layout> sdb::disassembler::decode_layout(span<const std::byte> code)
+{
+    ZydisDecoder decoder;
+    ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+
+    ZydisDecodedInstruction instr;
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    if (!ZYAN_SUCCESS(ZydisDecoderDecodeFull(&decoder, code.begin(), code.size(), &instr, operands))) return std::nullopt;
+
+    instruction_layout layout{instr.length, false, false, std::nullopt};
+
+    auto category = instr.meta.category;
+    layout.is_call = (category == ZYDIS_CATEGORY_CALL);
+
+    auto is_relative_branch = false;
+    for (auto& imm: instr.raw.imm)
+    {
+        if (imm.is_relative) is_relative_branch = true;
+    }
+
+    auto is_branch = (category == ZYDIS_CATEGORY_CALL) or (category == ZYDIS_CATEGORY_RET) or 
+        (category == ZYDIS_CATEGORY_UNCOND_BR) or (category == ZYDIS_CATEGORY_COND_BR);
+    layout.is_absolute_branch = is_branch and !is_relative_branch;
+
+    for (ZyanU8 i = 0; i < instr.operand_count; ++i)
+    {
+        auto& op = operands[i];
+        if ((op.type == ZYDIS_OPERAND_TYPE_MEMORY) and (op.mem.base == ZYDIS_REGISTER_RIP))
+        {
+            // Only disp32 can be rebased, and RIP-relative addressing always uses it
+            if (instr.raw.disp.size != 32) return std::nullopt;
+            layout.rip_displacement_offset = instr.raw.disp.offset;
+        }
+    }
+
+    return layout;
 }
\ No newline at end of file
@@ -5,10 +5,14 @@
 #include <libsdb/elf.hpp>
 #include <libsdb/process.hpp>
 #include <libsdb/type.hpp>
+#include <libsdb/index_cache.hpp>
 #include <string_view>
 #include <algorithm>
 #include <variant>
 #include <functional>
+#include <thread>
+#include <atomic>
+#include <exception>
 
 namespace
 {
@@ -262,12 +266,50 @@ namespace
             std::move(include_directories), std::move(file_names));
     }
 
-    std::unordered_map<std::uint64_t, sdb::abbrev> parse_abbrev_table(const sdb::elf& obj, std::size_t offset)
+    std::int8_t fixed_form_size(std::uint64_t form)
+    {
+        switch (form)
+        {
+            case DW_FORM_flag_present: return 0;
+
+            case DW_FORM_data1:
+            case DW_FORM_ref1:
+            case DW_FORM_flag: return 1;
+
+            case DW_FORM_data2:
+            case DW_FORM_ref2: return 2;
+
+            case DW_FORM_data4:
+            case DW_FORM_ref4:
+            case DW_FORM_ref_addr:
+            case DW_FORM_sec_offset:
+            case DW_FORM_strp: return 4;
+
+            case DW_FORM_data8:
+            case DW_FORM_addr: return 8;
+
+            default: return -1;
+        }
+    }
+
+    sdb::abbrev_table parse_abbrev_table(const sdb::elf& obj, std::size_t offset)
     {
         cursor cur(obj.get_section_contents(".debug_abbrev"));
         cur += offset;
 
-        std::unordered_map<std::uint64_t, sdb::abbrev> table;
+        struct pending_abbrev
+        {
+            std::uint64_t code;
+            std::uint64_t tag;
+            bool has_children;
+            std::int64_t fixed_size;
+            std::int32_t sibling_index;
+            std::size_t first_attr_spec;
+            std::size_t n_attr_specs;
+        };
+
+        std::vector<sdb::attr_spec> attr_specs;
+        std::vector<pending_abbrev> pending;
         std::uint64_t code = 0;
         do
         {
@@ -275,7 +317,9 @@ namespace
             auto tag = cur.uleb128();
             auto has_children = static_cast<bool>(cur.u8());
 
-            std::vector<sdb::attr_spec> attr_specs;
+            auto first_attr_spec = attr_specs.size();
+            std::int64_t fixed_offset = 0;
+            std::int32_t sibling_index = -1;
             std::uint64_t attr = 0;
             do
             {
@@ -283,19 +327,30 @@ namespace
                 auto form = cur.uleb128();
                 if (attr != 0)
                 {
-                    attr_specs.push_back(sdb::attr_spec{attr, form});
+                    auto fixed_size = fixed_form_size(form);
+                    if (attr == DW_AT_sibling) sibling_index = static_cast<std::int32_t>(attr_specs.size() - first_attr_spec);
+                    attr_specs.push_back(sdb::attr_spec{attr, form, fixed_size, static_cast<std::int32_t>(fixed_offset)});
+                    fixed_offset = ((fixed_offset >= 0) and (fixed_size >= 0)) ? fixed_offset + fixed_size : -1;
                 }
                 
             } while (attr != 0);
             
             if (code != 0)
             {
-                table.emplace(code, sdb::abbrev{code, tag, has_children, std::move(attr_specs)});
+                pending.push_back({code, tag, has_children, fixed_offset, sibling_index, first_attr_spec, attr_specs.size() - first_attr_spec});
             }
 
         } while (code != 0);
 
-        return table;
+        std::vector<sdb::abbrev> abbrevs;
+        abbrevs.reserve(pending.size());
+        for (auto& p: pending)
+        {
+            sdb::span<const sdb::attr_spec> specs{attr_specs.data() + p.first_attr_spec, p.n_attr_specs};
+            abbrevs.push_back(sdb::abbrev{p.code, p.tag, p.has_children, p.fixed_size, p.sibling_index, specs});
+        }
+
+        return sdb::abbrev_table(std::move(attr_specs), std::move(abbrevs));
     }
 
     std::unique_ptr<sdb::compile_unit> parse_compile_unit(sdb::dwarf& dwarf, const sdb::elf& obj, cursor cur)
@@ -354,18 +409,22 @@ namespace
             return sdb::die{next};
         }
 
-        auto& abbrev_table = cu.abbrev_table();
-        auto& abbrev = abbrev_table.at(abbrev_code);
-        std::vector<const std::byte*> attr_locs;
-        attr_locs.reserve(abbrev.attr_specs.size());
-        for (auto& attr: abbrev.attr_specs)
+        auto& abbrev = cu.abbrev_table().at(abbrev_code);
+        if (abbrev.fixed_size >= 0)
         {
-            attr_locs.push_back(cur.position());
-            cur.skip_form(attr.form);
+            cur += abbrev.fixed_size;
+
+        } else {
+
+            for (auto& attr: abbrev.attr_specs)
+            {
+                if (attr.fixed_size >= 0) cur += attr.fixed_size;
+                else cur.skip_form(attr.form);
+            }
         }
         
         auto next = cur.position();
-        return sdb::die(pos, &cu, &abbrev, std::move(attr_locs), next);
+        return sdb::die(pos, &cu, &abbrev, next);
     }
 
     bool path_ends_in(const std::filesystem::path& lhs, const std::filesystem::path& rhs)
@@ -378,6 +437,11 @@ namespace
         return std::equal(start, lhs.end(), rhs.begin());
     }
 
+    bool path_matches(const std::filesystem::path& file_path, const std::filesystem::path& path)
+    {
+        return path.is_absolute() ? (file_path == path) : path_ends_in(file_path, path);
+    }
+
     std::uint64_t parse_eh_frame_pointer_with_base(cursor& cur, std::uint8_t encoding, std::uint64_t base)
     {
         switch (encoding & 0x0f)
@@ -545,9 +609,10 @@ namespace
         return std::make_unique<sdb::call_frame_information>(&dwarf, eh_hdr);
     }
 
-    void execute_cfi_instruction(const sdb::elf& elf, const sdb::call_frame_information::frame_description_entry& fde, 
+    void execute_cfi_instruction(const sdb::dwarf& dwarf, const sdb::call_frame_information::frame_description_entry& fde, 
         unwind_context& ctx, sdb::file_addr pc)
     {
+        auto& elf = *dwarf.elf_file();
         auto& cie = *fde.cie;
         auto& cur = ctx.cur;
 
@@ -612,7 +677,7 @@ namespace
                 case DW_CFA_def_cfa_expression: 
                 {
                     auto length = cur.uleb128();
-                    auto expr = sdb::dwarf_expression{elf, {cur.position(), cur.position() + length}, true};
+                    auto expr = sdb::dwarf_expression{dwarf, {cur.position(), cur.position() + length}, true};
                     ctx.cfa_rule = cfa_expr_rule{expr};
                     break;
                 }
@@ -664,7 +729,7 @@ namespace
                 {
                     auto reg = cur.uleb128();
                     auto length = cur.uleb128();
-                    auto expr = sdb::dwarf_expression{elf, {cur.position(), cur.position() + length}, true};
+                    auto expr = sdb::dwarf_expression{dwarf, {cur.position(), cur.position() + length}, true};
                     ctx.register_rules.emplace(reg, expr_rule{expr});
                     break;
                 }
@@ -673,7 +738,7 @@ namespace
                 {
                     auto reg = cur.uleb128();
                     auto length = cur.uleb128();
-                    auto expr = sdb::dwarf_expression{elf, {cur.position(), cur.position() + length}, true};
+                    auto expr = sdb::dwarf_expression{dwarf, {cur.position(), cur.position() + length}, true};
                     ctx.register_rules.emplace(reg, val_expr_rule{expr});
                     break;
                 }
@@ -767,6 +832,106 @@ namespace
         return unwound_regs;
     }
 
+    using unwind_rule = sdb::call_frame_information::unwind_rule;
+    using unwind_row = sdb::call_frame_information::unwind_row;
+
+    bool compile_unwind_row(const unwind_context& ctx, std::uint64_t high, unwind_row& row)
+    {
+        row.high = high;
+        if (auto reg_rule = std::get_if<cfa_register_rule>(&ctx.cfa_rule))
+        {
+            row.cfa_register = reg_rule->reg;
+            row.cfa_offset = reg_rule->offset;
+
+        } else if (auto expr = std::get_if<cfa_expr_rule>(&ctx.cfa_rule)) {
+
+            row.cfa_is_expression = true;
+            row.cfa_expr = expr->expr.data();
+        }
+
+        for (auto& [reg, rule]: ctx.register_rules)
+        {
+            if (reg >= row.rules.size()) return false;
+
+            auto& compiled = row.rules[reg];
+            if (std::get_if<undefined_rule>(&rule)) compiled.kind = unwind_rule::undefined;
+            else if (std::get_if<same_rule>(&rule)) compiled.kind = unwind_rule::same_value;
+            else if (auto r = std::get_if<register_rule>(&rule)) compiled = {unwind_rule::in_register, r->reg};
+            else if (auto offset = std::get_if<offset_rule>(&rule)) compiled = {unwind_rule::offset, offset->offset};
+            else if (auto val_offset = std::get_if<val_offset_rule>(&rule)) compiled = {unwind_rule::val_offset, val_offset->offset};
+            else if (auto expr = std::get_if<expr_rule>(&rule)) compiled = {unwind_rule::expression, 0, expr->expr.data()};
+            else if (auto val_expr = std::get_if<val_expr_rule>(&rule)) compiled = {unwind_rule::val_expression, 0, val_expr->expr.data()};
+        }
+
+        return true;
+    }
+
+    sdb::registers execute_unwind_row(const sdb::dwarf& dwarf, const unwind_row& row, sdb::registers& old_regs, const sdb::process& proc)
+    {
+        auto unwound_regs = old_regs;
+
+        auto eval_address = [&](sdb::span<const std::byte> expr, bool push_cfa)
+        {
+            auto res = sdb::dwarf_expression{dwarf, expr, true}.eval(proc, old_regs, push_cfa);
+            auto& loc = std::get<sdb::dwarf_expression::simple_location>(res);
+            auto& addr_res = std::get<sdb::dwarf_expression::address_result>(loc);
+            return sdb::virt_addr{addr_res.address.addr()};
+        };
+
+        std::uint64_t cfa;
+        if (row.cfa_is_expression)
+        {
+            cfa = eval_address(row.cfa_expr, false).addr();
+
+        } else {
+
+            auto& reg_info = sdb::register_info_by_dwarf(row.cfa_register);
+            cfa = std::get<std::uint64_t>(old_regs.read(reg_info)) + row.cfa_offset;
+        }
+
+        old_regs.set_cfa(sdb::virt_addr{cfa});
+        unwound_regs.write_by_id(sdb::register_id::rsp, {cfa}, false);
+
+        for (std::size_t reg = 0; reg < row.rules.size(); ++reg)
+        {
+            auto& rule = row.rules[reg];
+            if ((rule.kind == unwind_rule::unspecified) or (rule.kind == unwind_rule::same_value)) continue;
+
+            auto& reg_info = sdb::register_info_by_dwarf(reg);
+            switch (rule.kind)
+            {
+                case unwind_rule::undefined: unwound_regs.undefine(reg_info.id); break;
+
+                case unwind_rule::in_register:
+
+                    unwound_regs.write(reg_info, old_regs.read(sdb::register_info_by_dwarf(rule.value)), false);
+                    break;
+
+                case unwind_rule::offset:
+                {
+                    auto addr = sdb::virt_addr{cfa + rule.value};
+                    unwound_regs.write(reg_info, {proc.read_memory_as<std::uint64_t>(addr)}, false);
+                    break;
+                }
+
+                case unwind_rule::val_offset: unwound_regs.write(reg_info, {cfa + rule.value}, false); break;
+
+                case unwind_rule::expression:
+                {
+                    auto addr = eval_address(rule.expr, true);
+                    unwound_regs.write(reg_info, {proc.read_memory_as<std::uint64_t>(addr)}, false);
+                    break;
+                }
+
+                case unwind_rule::val_expression: unwound_regs.write(reg_info, {eval_address(rule.expr, true).addr()}, false); break;
+
+                default: break;
+            }
+        }
+
+        return unwound_regs;
+    }
+
     sdb::virt_addr read_frame_base_result(const sdb::dwarf_expression::result& loc, const sdb::registers& regs)
     {
         auto simple_loc = std::get_if<sdb::dwarf_expression::simple_location>(&loc);
@@ -784,27 +949,117 @@ namespace
                 scopes.push_back(c);
             }
     }
+
+    std::string_view unqualified_name(std::string_view name)
+    {
+        std::size_t start = 0;
+        int depth = 0;
+        for (std::size_t i = 0; i < name.size(); ++i)
+        {
+            auto at_word_start = (i == 0) or (name[i - 1] == ':');
+            if ((depth == 0) and at_word_start and (name.substr(i, 8) == "operator")) break;
+
+            if ((name[i] == '<') or (name[i] == '('))
+            {
+                ++depth;
+
+            } else if (((name[i] == '>') or (name[i] == ')')) and (depth > 0)) {
+
+                --depth;
+
+            } else if ((depth == 0) and (name.substr(i, 2) == "::")) {
+
+                start = i + 2;
+                ++i;
+            }
+        }
+
+        return name.substr(start);
+    }
+
+    std::uint64_t read_name_index_value(cursor& cur, std::uint64_t form)
+    {
+        switch (form)
+        {
+            case DW_FORM_data1: return cur.u8();
+            case DW_FORM_data2: return cur.u16();
+            case DW_FORM_data4: return cur.u32();
+            case DW_FORM_data8: return cur.u64();
+            case DW_FORM_udata: return cur.uleb128();
+            case DW_FORM_ref1: return cur.u8();
+            case DW_FORM_ref2: return cur.u16();
+            case DW_FORM_ref4: return cur.u32();
+            case DW_FORM_ref8: return cur.u64();
+            case DW_FORM_ref_udata: return cur.uleb128();
+            default: sdb::error::send("Unsupported .debug_names form");
+        }
+    }
+
+    bool has_function_tag(const sdb::die& die)
+    {
+        auto tag = die.abbrev_entry()->tag;
+        return (tag == DW_TAG_subprogram) or (tag == DW_TAG_inlined_subroutine);
+    }
+
+    bool is_indexed_function(const sdb::die& die)
+    {
+        return has_function_tag(die) and (die.contains(DW_AT_low_pc) or die.contains(DW_AT_ranges));
+    }
+
+    bool is_indexed_variable(const sdb::die& die)
+    {
+        return (die.abbrev_entry()->tag == DW_TAG_variable) and die.contains(DW_AT_location);
+    }
+
 }
 
-const std::unordered_map<std::uint64_t, sdb::abbrev>& sdb::dwarf::get_abbrev_table(std::size_t offset)
+sdb::abbrev_table::abbrev_table(std::vector<attr_spec> attr_specs, std::vector<abbrev> abbrevs): attr_specs_(std::move(attr_specs))
 {
-    if (!abbrev_tables_.count(offset))
+    std::uint64_t max_code = 0;
+    for (auto& abbrev: abbrevs) max_code = std::max(max_code, abbrev.code);
+
+    auto dense_size = std::min<std::uint64_t>(max_code, 2 * abbrevs.size() + 16) + 1;
+    dense_.resize(dense_size, abbrev{0, 0, false, -1, -1, {}});
+    for (auto& abbrev: abbrevs)
     {
-        abbrev_tables_.emplace(offset, parse_abbrev_table(*elf_, offset));
+        if (abbrev.code < dense_size) dense_[abbrev.code] = abbrev;
+        else sparse_.emplace(abbrev.code, abbrev);
     }
+}
 
-    return abbrev_tables_.at(offset);
+const sdb::abbrev& sdb::abbrev_table::at(std::uint64_t code) const
+{
+    auto abbrev = find(code);
+    if (!abbrev) error::send("Invalid abbreviation code");
+    return *abbrev;
 }
 
-sdb::compile_unit::compile_unit(dwarf& parent, span<const std::byte> data, std::size_t abbrev_offset): 
-    parent_(&parent), data_(data), abbrev_offset_(abbrev_offset) 
+const sdb::abbrev_table& sdb::dwarf::get_abbrev_table(std::size_t offset)
 {
-    line_table_ = parse_line_table(*this);
+    auto it = abbrev_tables_.find(offset);
+    if (it == abbrev_tables_.end())
+    {
+        it = abbrev_tables_.emplace(offset, parse_abbrev_table(*elf_, offset)).first;
+    }
+
+    return it->second;
 }
 
-const std::unordered_map<std::uint64_t, sdb::abbrev>& sdb::compile_unit::abbrev_table() const
+sdb::compile_unit::compile_unit(dwarf& parent, span<const std::byte> data, std::size_t abbrev_offset): 
+    parent_(&parent), data_(data), abbrev_offset_(abbrev_offset), abbrev_table_(&parent.get_abbrev_table(abbrev_offset))
+{}
+
+const sdb::line_table& sdb::compile_unit::lines() const
 {
-    return parent_->get_abbrev_table(abbrev_offset_);
+    std::call_once(line_table_once_, [this]
+    {
+        line_table_ = parse_line_table(*this);
+
+        auto cache = parent_->elf_file()->get_index_cache();
+        if (line_table_ and cache) cache->load_line_table(*this, *line_table_);
+    });
+
+    return *line_table_;
 }
 
 sdb::dwarf::dwarf(const sdb::elf& parent): elf_(&parent)
@@ -846,9 +1101,10 @@ sdb::die::children_range::iterator& sdb::die::children_range::iterator::operator
         cursor next_cur({die_->next_, die_->cu_->data().end()});
         die_ = parse_die(*die_->cu_, next_cur);
 
-    } else if (die_->contains(DW_AT_sibling)) {
+    } else if (auto sibling = die_->sibling_position()) {
         
-        die_ = die_.value()[DW_AT_sibling].as_reference();
+        cursor next_cur({sibling, die_->cu_->data().end()});
+        die_ = parse_die(*die_->cu_, next_cur);
         
     } else {
 
@@ -876,7 +1132,7 @@ sdb::die::children_range sdb::die::children() const
 bool sdb::die::contains(std::uint64_t attribute) const
 {
     auto& specs = abbrev_->attr_specs;
-    return (std::find_if(begin(specs), end(specs), [=](auto spec) { return spec.attr == attribute; }) != end(specs));
+    return (std::find_if(specs.begin(), specs.end(), [=](auto spec) { return spec.attr == attribute; }) != specs.end());
 }
 
 sdb::attr sdb::die::operator[](std::uint64_t attribute) const
@@ -884,12 +1140,49 @@ sdb::attr sdb::die::operator[](std::uint64_t attribute) const
     auto& specs = abbrev_->attr_specs;
     for (std::size_t i = 0; i < specs.size(); ++i)
     {
-        if (specs[i].attr == attribute) return {cu_, specs[i].attr, specs[i].form, attr_locs_[i]};
+        if (specs[i].attr == attribute) return {cu_, specs[i].attr, specs[i].form, attribute_location(i)};
     }
 
     error::send("Attribute not found");
 }
 
+const std::byte* sdb::die::sibling_position() const
+{
+    if (abbrev_->sibling_index < 0) return nullptr;
+
+    cursor cur({attribute_location(abbrev_->sibling_index), cu_->data().end()});
+    switch (abbrev_->attr_specs[abbrev_->sibling_index].form)
+    {
+        case DW_FORM_ref1: return cu_->data().begin() + cur.u8();
+        case DW_FORM_ref2: return cu_->data().begin() + cur.u16();
+        case DW_FORM_ref4: return cu_->data().begin() + cur.u32();
+        case DW_FORM_ref8: return cu_->data().begin() + cur.u64();
+        case DW_FORM_ref_udata: return cu_->data().begin() + cur.uleb128();
+        default: return nullptr;
+    }
+}
+
+const std::byte* sdb::die::attribute_location(std::size_t index) const
+{
+    cursor cur({pos_, cu_->data().end()});
+    cur.uleb128();
+
+    auto& specs = abbrev_->attr_specs;
+    if (specs[index].fixed_offset >= 0) return cur.position() + specs[index].fixed_offset;
+
+    auto i = index;
+    while (specs[i].fixed_offset < 0) --i;
+    cur += specs[i].fixed_offset;
+
+    for (; i < index; ++i)
+    {
+        if (specs[i].fixed_size >= 0) cur += specs[i].fixed_size;
+        else cur.skip_form(specs[i].form);
+    }
+
+    return cur.position();
+}
+
 sdb::file_addr sdb::attr::as_address() const
 {
     cursor cur({location_, cu_->data().end()});
@@ -1133,32 +1426,233 @@ bool sdb::die::contains_address(file_addr address) const
 
 const sdb::compile_unit* sdb::dwarf::compile_unit_containing_address(file_addr address) const
 {
-    for (auto& cu: compile_units_)
+    if (address.elf_file() != elf_) return nullptr;
+    std::call_once(compile_unit_ranges_once_, [this] { build_compile_unit_ranges(); });
+
+    auto it = std::upper_bound(compile_unit_range_starts_.begin(), compile_unit_range_starts_.end(), address.addr());
+    if (it == compile_unit_range_starts_.begin()) return nullptr;
+
+    auto& range = compile_unit_ranges_[std::distance(compile_unit_range_starts_.begin(), it) - 1];
+    if (address.addr() >= range.high) return nullptr;
+
+    return range.cu;
+}
+
+void sdb::dwarf::build_compile_unit_ranges() const
+{
+    struct pc_range
+    {
+        std::uint64_t low;
+        std::uint64_t high;
+        const compile_unit* cu;
+    };
+
+    std::vector<pc_range> ranges;
+    std::vector<bool> covered(compile_units_.size(), false);
+
+    auto aranges = elf_->get_section_contents(".debug_aranges");
+    cursor cur(aranges);
+    while (!cur.finished())
+    {
+        // A truncated or DWARF64 set cannot be walked, so the remaining units fall back to their root DIE below
+        auto set_start = cur.position();
+        if (aranges.end() - set_start < 12) break;
+
+        auto length = cur.u32();
+        if (length >= 0xfffffff0) break;
+
+        auto set_end = cur.position() + std::min<std::ptrdiff_t>(length, aranges.end() - cur.position());
+        auto version = cur.u16();
+        auto info_offset = cur.u32();
+        auto address_size = cur.u8();
+        auto segment_size = cur.u8();
+
+        auto index = find_compile_unit_at_offset(info_offset);
+        if ((version != 2) or (address_size != 8) or (segment_size != 0) or (!index))
+        {
+            cur = cursor({set_end, aranges.end()});
+            continue;
+        }
+
+        auto tuple_size = 2 * address_size;
+        auto header_size = cur.position() - set_start;
+        cur += (tuple_size - header_size % tuple_size) % tuple_size;
+
+        while (set_end - cur.position() >= tuple_size)
+        {
+            auto low = cur.u64();
+            auto size = cur.u64();
+            if ((low == 0) and (size == 0)) break;
+            if (size == 0) continue;
+
+            ranges.push_back({low, low + size, compile_units_[*index].get()});
+            covered[*index] = true;
+        }
+
+        cur = cursor({set_end, aranges.end()});
+    }
+
+    for (std::size_t i = 0; i < compile_units_.size(); ++i)
+    {
+        if (covered[i]) continue;
+
+        auto cu = compile_units_[i].get();
+        auto root = cu->root();
+        if (root.contains(DW_AT_ranges))
+        {
+            for (auto& r: root[DW_AT_ranges].as_range_list()) ranges.push_back({r.low.addr(), r.high.addr(), cu});
+
+        } else if (root.contains(DW_AT_low_pc) and root.contains(DW_AT_high_pc)) {
+
+            ranges.push_back({root.low_pc().addr(), root.high_pc().addr(), cu});
+        }
+    }
+
+    std::sort(ranges.begin(), ranges.end(), [](auto& lhs, auto& rhs) { return lhs.low < rhs.low; });
+
+    std::vector<std::uint64_t> starts;
+    std::vector<compile_unit_range> merged;
+    for (auto& range: ranges)
     {
-        if (cu->root().contains_address(address)) return cu.get();
+        if (range.low >= range.high) continue;
+
+        if ((!merged.empty()) and (merged.back().cu == range.cu) and (merged.back().high == range.low))
+        {
+            merged.back().high = range.high;
+            continue;
+        }
+
+        starts.push_back(range.low);
+        merged.push_back({range.high, range.cu});
     }
 
-    return nullptr;
+    compile_unit_range_starts_ = std::move(starts);
+    compile_unit_ranges_ = std::move(merged);
+}
+
+std::optional<std::size_t> sdb::dwarf::find_compile_unit_at_offset(std::uint64_t offset) const
+{
+    auto debug_info = elf_->get_section_contents(".debug_info");
+    if (offset >= debug_info.size()) return std::nullopt;
+
+    auto pos = debug_info.begin() + offset;
+    auto it = std::lower_bound(compile_units_.begin(), compile_units_.end(), pos, 
+        [](auto& cu, auto pos) { return cu->data().begin() < pos; });
+    if ((it == compile_units_.end()) or ((*it)->data().begin() != pos)) return std::nullopt;
+    return std::distance(compile_units_.begin(), it);
 }
 
 std::optional<sdb::die> sdb::dwarf::function_containing_address(file_addr address) const
 {
     index();
+    if (address.elf_file() != elf_) return std::nullopt;
+
+    auto it = std::upper_bound(function_range_starts_.begin(), function_range_starts_.end(), address.addr());
+    if (it == function_range_starts_.begin()) return std::nullopt;
+
+    auto& range = function_ranges_[std::distance(function_range_starts_.begin(), it) - 1];
+    if (address.addr() >= range.high) return std::nullopt;
+
+    cursor cur({range.entry.pos, range.entry.cu->data().end()});
+    return parse_die(*range.entry.cu, cur);
+}
+
+void sdb::dwarf::build_function_ranges() const
+{
+    struct pc_range
+    {
+        std::uint64_t low;
+        std::uint64_t high;
+        index_entry entry;
+    };
+
+    std::vector<pc_range> ranges;
     for (auto& [name, entry]: function_index_)
     {
         cursor cur({entry.pos, entry.cu->data().end()});
         auto d = parse_die(*entry.cu, cur);
-        if (d.contains_address(address) && (d.abbrev_entry()->tag == DW_TAG_subprogram)) return d;
+        if (d.abbrev_entry()->tag != DW_TAG_subprogram) continue;
+
+        if (d.contains(DW_AT_ranges))
+        {
+            for (auto& r: d[DW_AT_ranges].as_range_list()) ranges.push_back({r.low.addr(), r.high.addr(), entry});
+
+        } else {
+
+            ranges.push_back({d.low_pc().addr(), d.high_pc().addr(), entry});
+        }
     }
 
-    return std::nullopt;
+    std::sort(ranges.begin(), ranges.end(), [](auto& lhs, auto& rhs)
+    {
+        return (lhs.low < rhs.low) or ((lhs.low == rhs.low) and (lhs.high > rhs.high));
+    });
+
+    function_range_starts_.clear();
+    function_ranges_.clear();
+
+    auto emit = [&](std::uint64_t low, std::uint64_t high, index_entry entry)
+    {
+        if (low >= high) return;
+        function_range_starts_.push_back(low);
+        function_ranges_.push_back({high, entry});
+    };
+
+    std::vector<const pc_range*> open_ranges;
+    std::uint64_t pos = 0;
+    for (auto& range: ranges)
+    {
+        while ((!open_ranges.empty()) and (open_ranges.back()->high <= range.low))
+        {
+            emit(pos, open_ranges.back()->high, open_ranges.back()->entry);
+            pos = std::max(pos, open_ranges.back()->high);
+            open_ranges.pop_back();
+        }
+
+        if (!open_ranges.empty()) emit(pos, range.low, open_ranges.back()->entry);
+
+        pos = range.low;
+        open_ranges.push_back(&range);
+    }
+
+    while (!open_ranges.empty())
+    {
+        emit(pos, open_ranges.back()->high, open_ranges.back()->entry);
+        pos = std::max(pos, open_ranges.back()->high);
+        open_ranges.pop_back();
+    }
 }
 
 std::vector<sdb::die> sdb::dwarf::find_functions(std::string name) const
 {
+    std::vector<die> found;
+    if (load_accelerator())
+    {
+        for (auto& function: accelerated_dies(name, accelerated_function))
+        {
+            if (is_indexed_function(function) and (function.name() == name)) found.push_back(function);
+        }
+
+        auto already_found = [&](const std::byte* pos)
+        {
+            return std::any_of(found.begin(), found.end(), [=](auto& function) { return function.position() == pos; });
+        };
+
+        for (auto cu: accelerated_compile_units(name, accelerated_function))
+        {
+            for (auto& [function_name, entry]: compile_unit_index_at(cu).functions)
+            {
+                if ((function_name != name) or already_found(entry.pos)) continue;
+                cursor cur({entry.pos, entry.cu->data().end()});
+                found.push_back(parse_die(*entry.cu, cur));
+            }
+        }
+
+        return found;
+    }
+
     index();
 
-    std::vector<die> found;
     auto [begin, end] = function_index_.equal_range(name);
     std::transform(begin, end, std::back_inserter(found), 
         [](auto& pair)
@@ -1173,12 +1667,340 @@ std::vector<sdb::die> sdb::dwarf::find_functions(std::string name) const
 
 void sdb::dwarf::index() const
 {
-    if (!function_index_.empty()) return;
+    std::call_once(index_once_, [this]
+    {
+        auto n_threads = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), compile_units_.size());
+        std::vector<partial_index> shards(compile_units_.size());
+        std::vector<std::exception_ptr> errors(n_threads);
+        std::atomic<std::size_t> next_cu = 0;
+
+        auto worker = [&](std::size_t thread_index)
+        {
+            try
+            {
+                for (auto i = next_cu++; i < compile_units_.size(); i = next_cu++)
+                {
+                    index_die(compile_units_[i]->root(), shards[i]);
+                }
+
+            } catch (...) {
+
+                errors[thread_index] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (std::size_t i = 1; i < n_threads; ++i) pool.emplace_back(worker, i);
+        if (n_threads > 0) worker(0);
+        for (auto& thread: pool) thread.join();
+
+        for (auto& error: errors) if (error) std::rethrow_exception(error);
+
+        std::size_t n_functions = 0;
+        std::size_t n_global_variables = 0;
+        for (auto& shard: shards)
+        {
+            n_functions += shard.functions.size();
+            n_global_variables += shard.global_variables.size();
+        }
+
+        function_index_.reserve(n_functions);
+        global_variable_index_.reserve(n_global_variables);
+
+        for (auto& shard: shards)
+        {
+            for (auto& [name, entry]: shard.functions) function_index_.emplace(name, entry);
+            for (auto& [name, entry]: shard.global_variables) global_variable_index_.emplace(name, entry);
+            for (auto& [pos, entry]: shard.member_functions) member_function_index_.insert(std::make_pair(pos, entry));
+        }
+
+        build_function_ranges();
+        indexed_ = true;
+    });
+}
+
+bool sdb::dwarf::load_accelerator() const
+{
+    std::call_once(accelerator_once_, [this]
+    {
+        auto try_load = [this](auto loader, std::string_view section_name)
+        {
+            auto section = elf_->get_section_contents(section_name);
+            if (section.size() == 0) return false;
+
+            try
+            {
+                if ((this->*loader)(section)) return true;
+
+            } catch (const sdb::error&) {}
+
+            accelerator_index_.clear();
+            unaccelerated_compile_units_.clear();
+            return false;
+        };
+
+        has_accelerator_ = try_load(&dwarf::load_debug_names, ".debug_names") or try_load(&dwarf::load_gdb_index, ".gdb_index");
+        if (has_accelerator_) compile_unit_indexes_ = std::make_unique<compile_unit_index[]>(compile_units_.size());
+    });
+
+    return has_accelerator_;
+}
+
+bool sdb::dwarf::load_gdb_index(span<const std::byte> data) const
+{
+    std::size_t header_size = 24;
+    if (data.size() < header_size) return false;
+
+    cursor cur(data);
+    auto version = cur.u32();
+    if ((version < 7) or (version > 8)) return false;
+
+    auto cu_list_offset = cur.u32();
+    auto types_cu_list_offset = cur.u32();
+    auto address_area_offset = cur.u32();
+    auto symbol_table_offset = cur.u32();
+    auto constant_pool_offset = cur.u32();
+    if ((cu_list_offset > types_cu_list_offset) or (types_cu_list_offset > address_area_offset) or
+        (address_area_offset > symbol_table_offset) or (symbol_table_offset > constant_pool_offset) or
+        (constant_pool_offset > data.size()))
+    {
+        return false;
+    }
+
+    std::vector<std::uint32_t> cus;
+    std::vector<bool> covered(compile_units_.size(), false);
+    cursor cu_list({data.begin() + cu_list_offset, data.begin() + types_cu_list_offset});
+    while (!cu_list.finished())
+    {
+        auto offset = cu_list.u64();
+        cu_list.u64();
+
+        auto index = find_compile_unit_at_offset(offset);
+        if (!index) return false;
+
+        cus.push_back(*index);
+        covered[*index] = true;
+    }
+
+    sdb::span<const std::byte> constant_pool{data.begin() + constant_pool_offset, data.end()};
+    cursor symbols({data.begin() + symbol_table_offset, constant_pool.begin()});
+    while (!symbols.finished())
+    {
+        auto name_offset = symbols.u32();
+        auto vector_offset = symbols.u32();
+        if ((name_offset == 0) and (vector_offset == 0)) continue;
+        if ((name_offset >= constant_pool.size()) or (std::size_t(vector_offset) + 4 > constant_pool.size())) return false;
+
+        cursor name_cur({constant_pool.begin() + name_offset, constant_pool.end()});
+        auto name = unqualified_name(name_cur.string());
+
+        cursor vector_cur({constant_pool.begin() + vector_offset, constant_pool.end()});
+        auto n_entries = vector_cur.u32();
+        if ((constant_pool.size() - vector_offset - 4) / 4 < n_entries) return false;
+
+        for (std::uint32_t i = 0; i < n_entries; ++i)
+        {
+            auto value = vector_cur.u32();
+            auto cu = value & 0xffffff;
+            auto kind = (value >> 28) & 0x7;
+            if (cu >= cus.size()) continue;
+
+            std::uint8_t kinds = 0;
+            if (kind == 0) kinds = accelerated_function | accelerated_variable;
+            else if (kind == 2) kinds = accelerated_variable;
+            else if (kind == 3) kinds = accelerated_function;
+            if (kinds) accelerator_index_.emplace(name, accelerator_entry{cus[cu], kinds});
+        }
+    }
+
+    for (std::size_t i = 0; i < covered.size(); ++i)
+    {
+        if (!covered[i]) unaccelerated_compile_units_.push_back(i);
+    }
+
+    return true;
+}
+
+bool sdb::dwarf::load_debug_names(span<const std::byte> data) const
+{
+    struct name_abbrev
+    {
+        std::uint64_t tag;
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> attributes;
+    };
+
+    auto debug_str = elf_->get_section_contents(".debug_str");
+    std::vector<bool> covered(compile_units_.size(), false);
+
+    cursor cur(data);
+    while (!cur.finished())
+    {
+        auto unit_length = cur.u32();
+        if (unit_length == 0xffffffff) return false;
+
+        auto unit_end = cur.position() + unit_length;
+        if (unit_end > data.end()) return false;
+
+        auto version = cur.u16();
+        cur.u16();
+        if (version != 5) return false;
+
+        auto comp_unit_count = cur.u32();
+        auto local_type_unit_count = cur.u32();
+        auto foreign_type_unit_count = cur.u32();
+        auto bucket_count = cur.u32();
+        auto name_count = cur.u32();
+        auto abbrev_table_size = cur.u32();
+        auto augmentation_string_size = cur.u32();
+        cur += augmentation_string_size;
+
+        std::vector<std::uint32_t> cus;
+        for (std::uint32_t i = 0; i < comp_unit_count; ++i)
+        {
+            auto index = find_compile_unit_at_offset(cur.u32());
+            if (!index) return false;
+
+            cus.push_back(*index);
+            covered[*index] = true;
+        }
+
+        cur += local_type_unit_count * 4 + foreign_type_unit_count * 8 + bucket_count * 4;
+        if (bucket_count > 0) cur += name_count * 4;
+
+        auto string_offsets = cur.position();
+        auto entry_offsets = string_offsets + name_count * 4;
+        auto abbrev_table = entry_offsets + name_count * 4;
+        auto entry_pool = abbrev_table + abbrev_table_size;
+        if (entry_pool > unit_end) return false;
+
+        std::unordered_map<std::uint64_t, name_abbrev> abbrevs;
+        cursor abbrev_cur({abbrev_table, entry_pool});
+        while (!abbrev_cur.finished())
+        {
+            auto code = abbrev_cur.uleb128();
+            if (code == 0) break;
+
+            auto& abbrev = abbrevs[code];
+            abbrev.tag = abbrev_cur.uleb128();
+            while (!abbrev_cur.finished())
+            {
+                auto index = abbrev_cur.uleb128();
+                auto form = abbrev_cur.uleb128();
+                if ((index == 0) and (form == 0)) break;
+                abbrev.attributes.emplace_back(index, form);
+            }
+        }
+
+        for (std::uint32_t i = 0; i < name_count; ++i)
+        {
+            auto string_offset = from_bytes<std::uint32_t>(string_offsets + i * 4);
+            auto entry_offset = from_bytes<std::uint32_t>(entry_offsets + i * 4);
+            if ((string_offset >= debug_str.size()) or (entry_pool + entry_offset >= unit_end)) return false;
+
+            cursor name_cur({debug_str.begin() + string_offset, debug_str.end()});
+            auto name = name_cur.string();
+
+            cursor entry_cur({entry_pool + entry_offset, unit_end});
+            while (!entry_cur.finished())
+            {
+                auto code = entry_cur.uleb128();
+                if (code == 0) break;
+
+                auto it = abbrevs.find(code);
+                if (it == abbrevs.end()) return false;
+
+                std::optional<std::uint64_t> cu;
+                std::optional<std::uint64_t> die_offset;
+                std::optional<std::uint64_t> parent;
+                if (comp_unit_count == 1) cu = 0;
+                for (auto [index, form]: it->second.attributes)
+                {
+                    if (index == DW_IDX_compile_unit) cu = read_name_index_value(entry_cur, form);
+                    else if (index == DW_IDX_die_offset) die_offset = read_name_index_value(entry_cur, form);
+                    else if ((index == DW_IDX_parent) and (form != DW_FORM_flag_present)) parent = read_name_index_value(entry_cur, form);
+                    else entry_cur.skip_form(form);
+                }
+
+                std::uint8_t kinds = 0;
+                auto tag = it->second.tag;
+                if ((tag == DW_TAG_subprogram) or (tag == DW_TAG_inlined_subroutine)) kinds = accelerated_function;
+                else if (tag == DW_TAG_variable) kinds = accelerated_variable;
+                if (!kinds or !cu or (*cu >= cus.size())) continue;
+
+                const std::byte* die_pos = nullptr;
+                auto& unit = *compile_units_[cus[*cu]];
+                if (die_offset)
+                {
+                    if (*die_offset >= unit.data().size()) return false;
+                    die_pos = unit.data().begin() + *die_offset;
+                }
+
+                // Only a variable whose parent entry is known can be told apart from a function's static local
+                if (kinds == accelerated_variable)
+                {
+                    auto parent_tag = std::optional<std::uint64_t>{};
+                    if (parent)
+                    {
+                        if (entry_pool + *parent >= unit_end) return false;
+                        cursor parent_cur({entry_pool + *parent, unit_end});
+                        auto parent_abbrev = abbrevs.find(parent_cur.uleb128());
+                        if (parent_abbrev == abbrevs.end()) return false;
+                        parent_tag = parent_abbrev->second.tag;
+                    }
+
+                    if (parent_tag and ((*parent_tag == DW_TAG_subprogram) or (*parent_tag == DW_TAG_inlined_subroutine))) continue;
+                    if (!parent_tag) die_pos = nullptr;
+                }
+
+                accelerator_index_.emplace(name, accelerator_entry{cus[*cu], kinds, die_pos});
+            }
+        }
+
+        cur = cursor({unit_end, data.end()});
+    }
+
+    for (std::size_t i = 0; i < covered.size(); ++i)
+    {
+        if (!covered[i]) unaccelerated_compile_units_.push_back(i);
+    }
+
+    return true;
+}
+
+std::vector<std::uint32_t> sdb::dwarf::accelerated_compile_units(std::string_view name, std::uint8_t kind) const
+{
+    auto cus = unaccelerated_compile_units_;
+    auto [begin, end] = accelerator_index_.equal_range(name);
+    for (auto it = begin; it != end; ++it)
+    {
+        if ((it->second.kinds & kind) and !it->second.die) cus.push_back(it->second.cu);
+    }
+
+    std::sort(cus.begin(), cus.end());
+    cus.erase(std::unique(cus.begin(), cus.end()), cus.end());
+    return cus;
+}
 
-    for (auto& cu: compile_units_)
+std::vector<sdb::die> sdb::dwarf::accelerated_dies(std::string_view name, std::uint8_t kind) const
+{
+    std::vector<die> dies;
+    auto [begin, end] = accelerator_index_.equal_range(name);
+    for (auto it = begin; it != end; ++it)
     {
-        index_die(cu->root());
+        if (!(it->second.kinds & kind) or !it->second.die) continue;
+
+        auto& cu = *compile_units_[it->second.cu];
+        cursor cur({it->second.die, cu.data().end()});
+        dies.push_back(parse_die(cu, cur));
     }
+    return dies;
+}
+
+const sdb::dwarf::partial_index& sdb::dwarf::compile_unit_index_at(std::size_t index) const
+{
+    auto& cu_index = compile_unit_indexes_[index];
+    std::call_once(cu_index.once, [&] { index_die(compile_units_[index]->root(), cu_index.index); });
+    return cu_index.index;
 }
 
 std::optional<std::string_view> sdb::die::name() const
@@ -1192,53 +2014,77 @@ std::optional<std::string_view> sdb::die::name() const
     return std::nullopt;
 }
 
-void sdb::dwarf::index_die(const die& current, bool in_function) const
+const std::byte* sdb::dwarf::index_die(const die& current, partial_index& index, bool in_function) const
 {
-    bool has_range = current.contains(DW_AT_low_pc) || current.contains(DW_AT_ranges);
-    bool is_function = (current.abbrev_entry()->tag == DW_TAG_subprogram) or (current.abbrev_entry()->tag == DW_TAG_inlined_subroutine);
-    if (has_range && is_function)
+    if (is_indexed_function(current))
     {
         if (auto name = current.name(); name)
         {
             index_entry entry{current.cu(), current.position()};
-            function_index_.emplace(*name, entry);
+            index.functions.emplace_back(*name, entry);
         }
     }
 
+    auto is_function = has_function_tag(current);
     if (is_function)
     {
         if (current.contains(DW_AT_specification))
         {
             index_entry entry{current.cu(), current.position()};
-            member_function_index_.insert(std::make_pair(current[DW_AT_specification].as_reference().position(), entry));
+            index.member_functions.push_back(std::make_pair(current[DW_AT_specification].as_reference().position(), entry));
 
         } else if (current.contains(DW_AT_abstract_origin)) {
 
             index_entry entry{current.cu(), current.position()};
-            member_function_index_.insert(std::make_pair(current[DW_AT_abstract_origin].as_reference().position(), entry));
+            index.member_functions.push_back(std::make_pair(current[DW_AT_abstract_origin].as_reference().position(), entry));
         }
     }
 
-    auto has_location = current.contains(DW_AT_location);
-    auto is_variable = (current.abbrev_entry()->tag == DW_TAG_variable);
-    if (has_location and is_variable and !in_function)
+    if (is_indexed_variable(current) and !in_function)
     {
         if (auto name = current.name())
         {
             index_entry entry{current.cu(), current.position()};
-            global_variable_index_.emplace(*name, entry);
+            index.global_variables.emplace_back(*name, entry);
         }
     }
 
+    if (!current.abbrev_entry()->has_children) return current.next();
+
     if (is_function) in_function = true;
-    for (auto child: current.children())
+    auto end = current.cu()->data().end();
+    cursor cur({current.next(), end});
+    while (true)
     {
-        index_die(child, in_function);
+        auto child = parse_die(*current.cu(), cur);
+        if (!child.abbrev_entry()) return child.next();
+
+        cur = cursor({index_die(child, index, in_function), end});
     }
 }
 
 std::optional<sdb::die> sdb::dwarf::find_global_variable(std::string name) const
 {
+    if (load_accelerator())
+    {
+        for (auto& variable: accelerated_dies(name, accelerated_variable))
+        {
+            if (is_indexed_variable(variable) and (variable.name() == name)) return variable;
+        }
+
+        for (auto cu: accelerated_compile_units(name, accelerated_variable))
+        {
+            for (auto& [variable_name, entry]: compile_unit_index_at(cu).global_variables)
+            {
+                if (variable_name != name) continue;
+                cursor cur({entry.pos, entry.cu->data().end()});
+                return parse_die(*entry.cu, cur);
+            }
+        }
+
+        return std::nullopt;
+    }
+
     index();
     auto it = global_variable_index_.find(name);
     if (it != global_variable_index_.end())
@@ -1249,15 +2095,16 @@ std::optional<sdb::die> sdb::dwarf::find_global_variable(std::string name) const
     return std::nullopt;
 }
 
-sdb::line_table::iterator::iterator(const sdb::line_table* table): table_(table), pos_(table->data_.begin())
+sdb::line_table::iterator::iterator(const sdb::line_table* table, const sdb::line_table::row* pos): table_(table), pos_(pos)
 {
-    registers_.is_stmt = table->default_is_stmt_;
-    ++(*this);
+    load();
 }
 
 sdb::line_table::iterator sdb::line_table::begin() const
 {
-    return iterator(this);
+    decode();
+    if (rows_.empty()) return end();
+    return iterator(this, rows_.data());
 }
 
 sdb::line_table::iterator sdb::line_table::end() const
@@ -1265,22 +2112,33 @@ sdb::line_table::iterator sdb::line_table::end() const
     return {};
 }
 
+void sdb::line_table::iterator::load()
+{
+    auto elf = table_->cu_->dwarf_info()->elf_file();
+    current_.address = file_addr{*elf, pos_->address};
+    current_.file_index = pos_->file_index;
+    current_.line = pos_->line;
+    current_.column = pos_->column;
+    current_.discriminator = pos_->discriminator;
+    current_.is_stmt = (pos_->flags & is_stmt_flag) != 0;
+    current_.basic_block_start = (pos_->flags & basic_block_start_flag) != 0;
+    current_.end_sequence = (pos_->flags & end_sequence_flag) != 0;
+    current_.prologue_end = (pos_->flags & prologue_end_flag) != 0;
+    current_.epilogue_begin = (pos_->flags & epilogue_begin_flag) != 0;
+    current_.file_entry = &table_->file_names_[current_.file_index - 1];
+}
+
 sdb::line_table::iterator& sdb::line_table::iterator::operator++() 
 {
-    if (pos_ == table_->data_.end())
+    if (pos_ == nullptr) return *this;
+
+    if (++pos_ == table_->rows_.data() + table_->rows_.size())
     {
         pos_ = nullptr;
         return *this;
     }
 
-    bool emitted = false;
-    do
-    {
-        emitted = execute_instruction();
-
-    } while (!emitted);
-
-    current_.file_entry = &table_->file_names_[current_.file_index - 1];
+    load();
     return *this;
 }
 
@@ -1291,125 +2149,253 @@ sdb::line_table::iterator sdb::line_table::iterator::operator++(int)
     return tmp;
 } 
 
-bool sdb::line_table::iterator::execute_instruction()
+void sdb::line_table::push_row(const entry& registers) const
 {
-    auto elf = table_->cu_->dwarf_info()->elf_file();
-    cursor cur({pos_, table_->data_.end()});
-    auto opcode = cur.u8();
-    bool emitted = false;
+    std::uint8_t flags = 0;
+    if (registers.is_stmt) flags |= is_stmt_flag;
+    if (registers.basic_block_start) flags |= basic_block_start_flag;
+    if (registers.end_sequence) flags |= end_sequence_flag;
+    if (registers.prologue_end) flags |= prologue_end_flag;
+    if (registers.epilogue_begin) flags |= epilogue_begin_flag;
+
+    rows_.push_back(row{registers.address.addr(), static_cast<std::uint32_t>(registers.file_index), static_cast<std::uint32_t>(registers.line),
+        static_cast<std::uint32_t>(registers.column), static_cast<std::uint32_t>(registers.discriminator), flags});
+}
 
-    if ((opcode > 0) && (opcode < table_->opcode_base_))
+void sdb::line_table::decode() const
+{
+    std::call_once(decode_once_, [this]
     {
-        switch (opcode)
+        // A throw leaves the flag unset, so drop the partial rows for the next attempt
+        auto n_files = file_names_.size();
+        try
         {
-            case DW_LNS_copy:
+            decode_program();
 
-                current_ = registers_;
-                registers_.basic_block_start = false;
-                registers_.prologue_end = false;
-                registers_.epilogue_begin = false;
-                registers_.discriminator = 0;
-                emitted = true;
-                break;
+        } catch (...) {
 
-            case DW_LNS_advance_pc: registers_.address += cur.uleb128(); break;
+            rows_.clear();
+            sequences_.clear();
+            file_names_.resize(n_files);
+            throw;
+        }
 
-            case DW_LNS_advance_line: registers_.line += cur.sleb128(); break;
+        decoded_ = true;
+    });
+}
 
-            case DW_LNS_set_file: registers_.file_index = cur.uleb128(); break;
+void sdb::line_table::decode_program() const
+{
+    auto elf = cu_->dwarf_info()->elf_file();
+    cursor cur(data_);
 
-            case DW_LNS_set_column: registers_.column = cur.uleb128(); break;
+    entry registers;
+    registers.is_stmt = default_is_stmt_;
+    std::size_t sequence_start = 0;
 
-            case DW_LNS_negate_stmt: registers_.is_stmt = !registers_.is_stmt; break;
+    auto reset_after_row = [&]
+    {
+        registers.basic_block_start = false;
+        registers.prologue_end = false;
+        registers.epilogue_begin = false;
+        registers.discriminator = 0;
+    };
 
-            case DW_LNS_set_basic_block: registers_.basic_block_start = true; break;
+    while (!cur.finished())
+    {
+        auto opcode = cur.u8();
 
-            case DW_LNS_const_add_pc: registers_.address += (255 - table_->opcode_base_) / table_->line_range_; break;
+        if ((opcode > 0) && (opcode < opcode_base_))
+        {
+            switch (opcode)
+            {
+                case DW_LNS_copy:
 
-            case DW_LNS_fixed_advance_pc: registers_.address += cur.u16(); break;
+                    push_row(registers);
+                    reset_after_row();
+                    break;
 
-            case DW_LNS_set_prologue_end: registers_.prologue_end = true; break;
+                case DW_LNS_advance_pc: registers.address += cur.uleb128(); break;
 
-            case DW_LNS_set_epilogue_begin: registers_.epilogue_begin = true; break;
+                case DW_LNS_advance_line: registers.line += cur.sleb128(); break;
 
-            case DW_LNS_set_isa: break;
+                case DW_LNS_set_file: registers.file_index = cur.uleb128(); break;
 
-            default: error::send("Unexpected standard opcode");
-        }
+                case DW_LNS_set_column: registers.column = cur.uleb128(); break;
 
-    } else if (opcode == 0) {
+                case DW_LNS_negate_stmt: registers.is_stmt = !registers.is_stmt; break;
 
-        auto length = cur.uleb128();
-        auto extended_opcode = cur.u8();
+                case DW_LNS_set_basic_block: registers.basic_block_start = true; break;
 
-        switch (extended_opcode)
-        {
-            case DW_LNE_end_sequence:
+                case DW_LNS_const_add_pc: registers.address += (255 - opcode_base_) / line_range_; break;
 
-                registers_.end_sequence = true;
-                current_ = registers_;
-                registers_ = entry{};
-                registers_.is_stmt = table_->default_is_stmt_;
-                emitted = true;
-                break;
+                case DW_LNS_fixed_advance_pc: registers.address += cur.u16(); break;
 
-            case DW_LNE_set_address: registers_.address = file_addr(*elf, cur.u64()); break;
+                case DW_LNS_set_prologue_end: registers.prologue_end = true; break;
 
-            case DW_LNE_define_file:
-            {
-                auto compilation_dir = table_->cu_->root()[DW_AT_comp_dir].as_string();
-                auto file = parse_line_table_file(cur, std::string(compilation_dir), table_->include_directories_);
-                table_->file_names_.push_back(file);
-                break;
+                case DW_LNS_set_epilogue_begin: registers.epilogue_begin = true; break;
+
+                case DW_LNS_set_isa: break;
+
+                default: error::send("Unexpected standard opcode");
             }
 
-            case DW_LNE_set_discriminator: registers_.discriminator = cur.uleb128(); break;
+        } else if (opcode == 0) {
 
-            default: error::send("Unexpected extended opcode");
-        }
+            auto length = cur.uleb128();
+            auto extended_opcode = cur.u8();
 
-    } else {
+            switch (extended_opcode)
+            {
+                case DW_LNE_end_sequence:
+                {
+                    registers.end_sequence = true;
+                    push_row(registers);
+
+                    auto low = rows_[sequence_start].address;
+                    auto high = rows_.back().address;
+                    sequences_.push_back(sequence{low, high, static_cast<std::uint32_t>(sequence_start), static_cast<std::uint32_t>(rows_.size())});
+                    sequence_start = rows_.size();
+
+                    registers = entry{};
+                    registers.is_stmt = default_is_stmt_;
+                    break;
+                }
+
+                case DW_LNE_set_address: registers.address = file_addr(*elf, cur.u64()); break;
 
-        auto adjusted_opcode = opcode - table_->opcode_base_;
-        registers_.address += adjusted_opcode / table_->line_range_;
-        registers_.line += table_->line_base_ + (adjusted_opcode % table_->line_range_);
-        current_ = registers_;
-        registers_.basic_block_start = false;
-        registers_.prologue_end = false;
-        registers_.epilogue_begin = false;
-        registers_.discriminator = 0;
-        emitted = true;
+                case DW_LNE_define_file:
+                {
+                    auto compilation_dir = cu_->root()[DW_AT_comp_dir].as_string();
+                    auto file = parse_line_table_file(cur, std::string(compilation_dir), include_directories_);
+                    file_names_.push_back(file);
+                    break;
+                }
+
+                case DW_LNE_set_discriminator: registers.discriminator = cur.uleb128(); break;
+
+                default: error::send("Unexpected extended opcode");
+            }
+
+        } else {
+
+            auto adjusted_opcode = opcode - opcode_base_;
+            registers.address += adjusted_opcode / line_range_;
+            registers.line += line_base_ + (adjusted_opcode % line_range_);
+            push_row(registers);
+            reset_after_row();
+        }
     }
 
-    pos_ = cur.position();
-    return emitted;
+    std::sort(sequences_.begin(), sequences_.end(), [](auto& lhs, auto& rhs)
+    {
+        return (lhs.low < rhs.low) or ((lhs.low == rhs.low) and (lhs.high < rhs.high));
+    });
 }
 
 sdb::line_table::iterator sdb::line_table::get_entry_by_address(file_addr address) const
 {
-    auto prev = begin();
-    if (prev == end()) return prev;
+    decode();
+
+    auto addr = address.addr();
+    auto seq = std::upper_bound(sequences_.begin(), sequences_.end(), addr, [](auto addr, auto& seq) { return addr < seq.low; });
+    if (seq == sequences_.begin()) return end();
 
-    auto it = prev;
-    for (++it; it != end(); prev = it++) if ((prev->address <= address) && (it->address > address) && (!prev->end_sequence)) return prev;
+    --seq;
+    if (seq->high <= addr) return end();
 
-    return end();
+    auto first = rows_.begin() + seq->first_row;
+    auto last = rows_.begin() + seq->end_row;
+    auto it = std::prev(std::upper_bound(first, last, addr, [](auto addr, auto& r) { return addr < r.address; }));
+    if (it->flags & end_sequence_flag) return end();
+
+    return iterator(this, &*it);
 }
 
 std::vector<sdb::line_table::iterator> sdb::line_table::get_entries_by_line(std::filesystem::path path, std::size_t line) const
 {
+    decode();
+
+    std::vector<bool> matching_files;
+    matching_files.reserve(file_names_.size());
+    for (auto& file: file_names_) matching_files.push_back(path_matches(file.path, path));
+
     std::vector<iterator> entries;
+    for (auto& row: rows_)
+    {
+        if ((row.line == line) and (row.file_index - 1 < matching_files.size()) and matching_files[row.file_index - 1])
+            entries.emplace_back(this, &row);
+    }
+
+    return entries;
+}
+
+std::vector<sdb::line_table::iterator> sdb::dwarf::get_line_entries_by_line(std::filesystem::path path, std::size_t line) const
+{
+    std::call_once(line_index_once_, [this] { build_line_index(); });
 
-    for (auto it = begin(); it != end(); ++it)
+    struct found_row
     {
-        auto& entry_path = it->file_entry->path;
-        if ((it->line == line) && ((path.is_absolute() && (entry_path == path)) || (path.is_relative() && path_ends_in(entry_path, path)))) 
-            entries.push_back(it);
+        std::size_t cu_index;
+        std::uint32_t row;
+        const line_table* table;
+    };
+
+    std::vector<found_row> found;
+    if (auto it = line_index_.find(path.filename().string()); it != line_index_.end())
+    {
+        for (auto& file: it->second)
+        {
+            if (!path_matches(file.file->path, path)) continue;
+
+            auto [begin, end] = std::equal_range(file.rows_by_line.begin(), file.rows_by_line.end(), std::make_pair(line, 0),
+                [](auto& lhs, auto& rhs) { return lhs.first < rhs.first; });
+            for (auto row = begin; row != end; ++row) found.push_back({file.cu_index, row->second, file.table});
+        }
     }
 
+    std::sort(found.begin(), found.end(), [](auto& lhs, auto& rhs)
+    {
+        return (lhs.cu_index < rhs.cu_index) or ((lhs.cu_index == rhs.cu_index) and (lhs.row < rhs.row));
+    });
+
+    std::vector<line_table::iterator> entries;
+    entries.reserve(found.size());
+    for (auto& row: found) entries.emplace_back(row.table, &row.table->rows_[row.row]);
+
     return entries;
 }
 
+void sdb::dwarf::build_line_index() const
+{
+    for (std::size_t cu_index = 0; cu_index < compile_units_.size(); ++cu_index)
+    {
+        auto& cu = compile_units_[cu_index];
+        if (!cu->root().contains(DW_AT_stmt_list)) continue;
+
+        auto& table = cu->lines();
+        table.decode();
+
+        std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> rows_by_file(table.file_names_.size());
+        for (std::uint32_t i = 0; i < table.rows_.size(); ++i)
+        {
+            auto& row = table.rows_[i];
+            if (row.file_index - 1 < rows_by_file.size()) rows_by_file[row.file_index - 1].emplace_back(row.line, i);
+        }
+
+        for (std::size_t i = 0; i < rows_by_file.size(); ++i)
+        {
+            if (rows_by_file[i].empty()) continue;
+
+            auto& rows = rows_by_file[i];
+            std::stable_sort(rows.begin(), rows.end(), [](auto& lhs, auto& rhs) { return lhs.first < rhs.first; });
+
+            auto& file = table.file_names_[i];
+            line_index_[file.path.filename().string()].push_back({&table, cu_index, &file, std::move(rows)});
+        }
+    }
+}
+
 sdb::source_location sdb::die::location() const
 {
     return {&file(), line()};
@@ -1508,6 +2494,18 @@ const std::byte* sdb::call_frame_information::eh_hdr::operator[](file_addr addre
 
 sdb::registers sdb::call_frame_information::unwind(const process& proc, file_addr pc, registers& regs) const
 {
+    const unwind_row* cached_row = nullptr;
+    {
+        std::lock_guard lock(unwind_rows_mutex_);
+        auto it = unwind_rows_.upper_bound(pc.addr());
+        if ((it != unwind_rows_.begin()) and (pc.addr() < std::prev(it)->second.high))
+        {
+            cached_row = &std::prev(it)->second;
+            ++cached_unwinds_;
+        }
+    }
+    if (cached_row) return execute_unwind_row(*dwarf_, *cached_row, regs, proc);
+
     auto fde_start = eh_hdr_[pc];
     auto eh_frame_end = dwarf_->elf_file()->get_section_contents(".eh_frame").end();
 
@@ -1518,14 +2516,31 @@ sdb::registers sdb::call_frame_information::unwind(const process& proc, file_add
     unwind_context ctx{};
     ctx.cur = cursor(fde.cie->instructions);
 
-    while (!ctx.cur.finished()) execute_cfi_instruction(*dwarf_->elf_file(), fde, ctx, pc);
+    while (!ctx.cur.finished()) execute_cfi_instruction(*dwarf_, fde, ctx, pc);
 
     ctx.cie_register_rules = ctx.register_rules;
     ctx.cur = cursor(fde.instructions);
     ctx.location = fde.initial_location;
 
-    while ((!ctx.cur.finished()) && (ctx.location <= pc)) execute_cfi_instruction(*dwarf_->elf_file(), fde, ctx, pc);
+    auto row_low = ctx.location;
+    while ((!ctx.cur.finished()) && (ctx.location <= pc))
+    {
+        row_low = ctx.location;
+        execute_cfi_instruction(*dwarf_, fde, ctx, pc);
+    }
 
+    auto row_high = fde.initial_location + fde.address_range;
+    if (ctx.location > pc) row_high = ctx.location;
+    else row_low = ctx.location;
+
+    unwind_row row;
+    if ((row_low <= pc) and (pc < row_high) and compile_unwind_row(ctx, row_high.addr(), row))
+    {
+        std::lock_guard lock(unwind_rows_mutex_);
+        cached_row = &unwind_rows_.insert_or_assign(row_low.addr(), row).first->second;
+    }
+
+    if (cached_row) return execute_unwind_row(*dwarf_, *cached_row, regs, proc);
     return execute_unwind_rules(ctx, regs, proc);
 }
 
@@ -1828,7 +2843,6 @@ sdb::dwarf_expression::result sdb::location_list::eval(const sdb::process& proc,
 {
     auto virt_pc = virt_addr{regs.read_by_id_as<std::uint64_t>(register_id::rip)};
     auto pc = virt_pc.to_file_addr(*parent_->elf_file());
-    auto func = parent_->function_containing_address(pc);
 
     cursor cur({expr_data_.begin(), expr_data_.end()});
     constexpr auto base_address_flag = ~static_cast<std::uint64_t>(0);
@@ -9,6 +9,7 @@
 #include <libsdb/error.hpp>
 #include <libsdb/bit.hpp>
 #include <libsdb/dwarf.hpp>
+#include <libsdb/index_cache.hpp>
 
 sdb::elf::elf(const std::filesystem::path& path)
 {
@@ -39,13 +40,27 @@ sdb::elf::elf(const std::filesystem::path& path)
     parse_section_headers();
     build_section_map();
     parse_symbol_table();
+
+    if (index_cache::directory()) cache_ = index_cache::open(*this);
     build_symbol_maps();
 
     dwarf_ = std::make_unique<dwarf>(*this);
+
+    if (cache_) cache_->load_dwarf(*dwarf_);
 }
 
 sdb::elf::~elf()
 {
+    // Written on close rather than on open so a cache miss keeps indexing and line tables lazy
+    try
+    {
+        if (!cache_ and index_cache::directory()) index_cache::store(*this);
+
+    } catch (...) {
+
+        // A cache that cannot be written only costs the next load its speed-up
+    }
+
     munmap(data_, file_size_);
     close(fd_);
 }
@@ -160,15 +175,20 @@ void sdb::elf::parse_symbol_table()
 
 void sdb::elf::build_symbol_maps()
 {
+    if (cache_) cache_->load_symbols(*this);
+
     for (auto& symbol: symbol_table_)
     {
         auto mangled_name = get_string(symbol.st_name);
-        int demangle_status;
-        auto demangled_name = abi::__cxa_demangle(mangled_name.data(), nullptr, nullptr, &demangle_status);
-        if (demangle_status == 0)
+        if (!cache_)
         {
-            symbol_name_map_.insert({demangled_name, &symbol});
-            free(demangled_name);
+            int demangle_status;
+            auto demangled_name = abi::__cxa_demangle(mangled_name.data(), nullptr, nullptr, &demangle_status);
+            if (demangle_status == 0)
+            {
+                symbol_name_map_.insert({demangled_names_.emplace_back(demangled_name), &symbol});
+                free(demangled_name);
+            }
         }
         symbol_name_map_.insert({mangled_name, &symbol});
 
@@ -180,6 +200,29 @@ void sdb::elf::build_symbol_maps()
     }
 }
 
+std::optional<std::string> sdb::elf::build_id() const
+{
+    auto notes = get_section_contents(".note.gnu.build-id");
+    if (notes.size() < sizeof(Elf64_Nhdr)) return std::nullopt;
+
+    auto header = from_bytes<Elf64_Nhdr>(notes.begin());
+    if (header.n_type != NT_GNU_BUILD_ID) return std::nullopt;
+
+    auto desc = notes.begin() + sizeof(Elf64_Nhdr) + ((header.n_namesz + 3) & ~3);
+    if (desc + header.n_descsz > notes.end()) return std::nullopt;
+
+    std::string id;
+    constexpr auto hex_digits = "0123456789abcdef";
+    for (auto byte = desc; byte != desc + header.n_descsz; ++byte)
+    {
+        auto value = std::to_integer<std::uint8_t>(*byte);
+        id += hex_digits[value >> 4];
+        id += hex_digits[value & 0xf];
+    }
+
+    return id;
+}
+
 std::vector<const Elf64_Sym*> sdb::elf::get_symbols_by_name(std::string_view name) const
 {
     auto [begin, end] = symbol_name_map_.equal_range(name);
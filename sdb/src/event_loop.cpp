@@ -0,0 +1,233 @@
+#include <libsdb/event_loop.hpp>
+#include <libsdb/process.hpp>
+#include <libsdb/error.hpp>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <pthread.h>
+
+namespace
+{
+    constexpr int max_events_per_wait = 64;
+
+    int open_pidfd(pid_t pid)
+    {
+#ifdef SYS_pidfd_open
+        return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+        return -1;
+#endif
+    }
+}
+
+sdb::event_loop::event_loop()
+{
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+
+    if ((epoll_fd_ = epoll_create1(EPOLL_CLOEXEC)) < 0)
+    {
+        error::send_errno("Could not create epoll instance");
+    }
+
+    pthread_sigmask(SIG_BLOCK, &mask, &old_mask_);
+    if ((signal_fd_ = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) < 0)
+    {
+        auto saved_errno = errno;
+        pthread_sigmask(SIG_SETMASK, &old_mask_, nullptr);
+        close(epoll_fd_);
+        errno = saved_errno;
+        error::send_errno("Could not create signalfd");
+    }
+
+    add_fd(signal_fd_, [this] {
+        drain_signals();
+        drain_process_events();
+    });
+}
+
+sdb::event_loop::~event_loop()
+{
+    for (auto& watched: processes_)
+    {
+        if (watched.pidfd >= 0) close(watched.pidfd);
+    }
+    for (auto timer_fd: timers_) close(timer_fd);
+
+    close(signal_fd_);
+    close(epoll_fd_);
+    pthread_sigmask(SIG_SETMASK, &old_mask_, nullptr);
+}
+
+void sdb::event_loop::watch(process& proc, std::function<void(const stop_reason&)> on_stop)
+{
+    auto pidfd = open_pidfd(proc.pid());
+    processes_.push_back({&proc, pidfd, std::move(on_stop)});
+    if (pidfd >= 0) add_fd(pidfd, [this] { drain_process_events(); });
+
+    // SIGCHLDs raised before the loop existed were discarded, so look once
+    needs_drain_ = true;
+}
+
+void sdb::event_loop::unwatch(process& proc)
+{
+    auto it = std::find_if(processes_.begin(), processes_.end(), [&](auto& w) { return w.proc == &proc; });
+    if (it == processes_.end()) return;
+
+    if (it->pidfd >= 0)
+    {
+        remove_fd(it->pidfd);
+        close(it->pidfd);
+    }
+    processes_.erase(it);
+}
+
+void sdb::event_loop::add_fd(int fd, std::function<void()> on_ready)
+{
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        error::send_errno("Could not add file descriptor to event loop");
+    }
+    handlers_[fd] = std::move(on_ready);
+}
+
+void sdb::event_loop::remove_fd(int fd)
+{
+    if (handlers_.erase(fd) == 0) return;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+int sdb::event_loop::add_timer(std::chrono::nanoseconds interval, std::function<void()> on_tick)
+{
+    auto timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) error::send_errno("Could not create timer");
+
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(interval);
+    itimerspec spec{};
+    spec.it_interval.tv_sec = seconds.count();
+    spec.it_interval.tv_nsec = (interval - seconds).count();
+    spec.it_value = spec.it_interval;
+    if ((spec.it_value.tv_sec == 0) and (spec.it_value.tv_nsec == 0)) spec.it_value.tv_nsec = 1;
+
+    if (timerfd_settime(timer_fd, 0, &spec, nullptr) < 0)
+    {
+        auto saved_errno = errno;
+        close(timer_fd);
+        errno = saved_errno;
+        error::send_errno("Could not arm timer");
+    }
+
+    add_fd(timer_fd, [timer_fd, on_tick = std::move(on_tick)] {
+        std::uint64_t expirations;
+        if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) on_tick();
+    });
+    timers_.push_back(timer_fd);
+    return timer_fd;
+}
+
+void sdb::event_loop::remove_timer(int timer_fd)
+{
+    auto it = std::find(timers_.begin(), timers_.end(), timer_fd);
+    if (it == timers_.end()) return;
+
+    timers_.erase(it);
+    remove_fd(timer_fd);
+    close(timer_fd);
+}
+
+std::size_t sdb::event_loop::run_once(std::optional<std::chrono::milliseconds> timeout)
+{
+    // Stops a process queued while busy with something else raise no SIGCHLD of their own
+    auto has_pending_stops = std::any_of(processes_.begin(), processes_.end(),
+        [](auto& w) { return w.proc->has_pending_stops(); });
+
+    if (needs_drain_ or has_pending_stops)
+    {
+        needs_drain_ = false;
+        if (auto n_stops = drain_process_events(); n_stops > 0) return n_stops;
+    }
+
+    epoll_event events[max_events_per_wait];
+    int n_events;
+    do
+    {
+        n_events = epoll_wait(epoll_fd_, events, max_events_per_wait, timeout ? static_cast<int>(timeout->count()) : -1);
+    } while ((n_events < 0) and (errno == EINTR));
+
+    if (n_events < 0) error::send_errno("epoll_wait failed");
+
+    std::size_t n_handled = 0;
+    for (int i = 0; i < n_events; ++i)
+    {
+        // Handlers may remove themselves or others, so look each one up afresh
+        auto it = handlers_.find(events[i].data.fd);
+        if (it == handlers_.end()) continue;
+
+        auto handler = it->second;
+        handler();
+        ++n_handled;
+    }
+
+    return n_handled;
+}
+
+void sdb::event_loop::run()
+{
+    stopping_ = false;
+    while (!stopping_) run_once();
+}
+
+void sdb::event_loop::drain_signals()
+{
+    signalfd_siginfo info[16];
+    while (read(signal_fd_, info, sizeof(info)) > 0);
+}
+
+std::size_t sdb::event_loop::drain_process_events()
+{
+    auto is_finished = [](process& proc) {
+        return (proc.state() == process_state::exited) or (proc.state() == process_state::terminated);
+    };
+
+    std::vector<process*> procs;
+    for (auto& watched: processes_) procs.push_back(watched.proc);
+
+    std::size_t n_stops = 0;
+    for (auto proc: procs)
+    {
+        auto find_watched = [&] {
+            return std::find_if(processes_.begin(), processes_.end(), [&](auto& w) { return w.proc == proc; });
+        };
+
+        // SIGCHLD coalesces, so keep collecting until the kernel has nothing left.
+        // Stop callbacks may unwatch the process, so it is looked up after each one.
+        while (!is_finished(*proc))
+        {
+            auto reason = proc->poll_signal();
+            if (!reason) break;
+
+            ++n_stops;
+            auto watched = find_watched();
+            if (watched == processes_.end()) break;
+
+            auto on_stop = watched->on_stop;
+            on_stop(*reason);
+        }
+
+        auto watched = find_watched();
+        if ((watched != processes_.end()) and (watched->pidfd >= 0) and is_finished(*proc))
+        {
+            remove_fd(watched->pidfd);
+        }
+    }
+
+    return n_stops;
+}
@@ -0,0 +1,502 @@
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <libsdb/index_cache.hpp>
+#include <libsdb/elf.hpp>
+#include <libsdb/dwarf.hpp>
+#include <libsdb/error.hpp>
+#include <libsdb/bit.hpp>
+
+namespace
+{
+    std::optional<std::filesystem::path> g_cache_directory;
+
+    constexpr char cache_magic[8] = {'S', 'D', 'B', 'I', 'D', 'X', '\0', '\0'};
+    constexpr std::uint32_t cache_version = 1;
+
+    enum table_id : std::size_t
+    {
+        strings_table,
+        symbols_table,
+        functions_table,
+        global_variables_table,
+        member_functions_table,
+        function_ranges_table,
+        compile_unit_ranges_table,
+        line_tables_table,
+        line_rows_table,
+        line_sequences_table,
+        n_tables
+    };
+
+    struct table_location
+    {
+        std::uint64_t offset;
+        std::uint64_t count;
+    };
+
+    struct cache_header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t n_compile_units;
+        std::int64_t mtime_sec;
+        std::int64_t mtime_nsec;
+        std::uint64_t file_size;
+        table_location tables[n_tables];
+    };
+
+    struct symbol_record
+    {
+        std::uint32_t name;
+        std::uint32_t symbol;
+    };
+
+    struct name_record
+    {
+        std::uint32_t name;
+        std::uint32_t cu;
+        std::uint64_t die;
+    };
+
+    struct member_function_record
+    {
+        std::uint64_t declaration;
+        std::uint64_t die;
+        std::uint32_t cu;
+        std::uint32_t padding;
+    };
+
+    struct range_record
+    {
+        std::uint64_t low;
+        std::uint64_t high;
+        std::uint64_t die;
+        std::uint32_t cu;
+        std::uint32_t padding;
+    };
+
+    struct line_table_record
+    {
+        std::uint32_t cu;
+        std::uint32_t n_files;
+        std::uint64_t first_row;
+        std::uint64_t n_rows;
+        std::uint64_t first_sequence;
+        std::uint64_t n_sequences;
+    };
+
+    // line_table::row has tail padding, so rows are written field by field
+    struct row_record
+    {
+        std::uint64_t address;
+        std::uint32_t file_index;
+        std::uint32_t line;
+        std::uint32_t column;
+        std::uint32_t discriminator;
+        std::uint8_t flags;
+        std::uint8_t padding[7];
+    };
+
+    std::optional<std::filesystem::path> cache_path(const sdb::elf& obj)
+    {
+        if (!g_cache_directory) return std::nullopt;
+
+        auto id = obj.build_id();
+        if (!id) return std::nullopt;
+
+        return *g_cache_directory / (*id + ".sdbidx");
+    }
+
+    class cache_writer
+    {
+        private:
+
+            std::vector<std::byte> tables_[n_tables];
+            std::unordered_map<std::string_view, std::uint32_t> string_offsets_;
+
+        public:
+
+            std::uint32_t add_string(std::string_view str)
+            {
+                if (auto it = string_offsets_.find(str); it != string_offsets_.end()) return it->second;
+
+                auto& strings = tables_[strings_table];
+                auto offset = static_cast<std::uint32_t>(strings.size());
+                auto data = reinterpret_cast<const std::byte*>(str.data());
+                strings.insert(strings.end(), data, data + str.size());
+                strings.push_back(std::byte{0});
+                string_offsets_.emplace(str, offset);
+                return offset;
+            }
+
+            template <class T> void add(table_id table, const T& record)
+            {
+                auto bytes = sdb::as_bytes(record);
+                tables_[table].insert(tables_[table].end(), bytes, bytes + sizeof(T));
+            }
+
+            template <class T> void add_all(table_id table, const std::vector<T>& records)
+            {
+                auto bytes = reinterpret_cast<const std::byte*>(records.data());
+                tables_[table].insert(tables_[table].end(), bytes, bytes + records.size() * sizeof(T));
+            }
+
+            std::uint64_t size(table_id table) const { return tables_[table].size(); }
+
+            bool write(const std::filesystem::path& path, cache_header header, const std::vector<std::size_t>& record_sizes)
+            {
+                std::vector<std::byte> file(sizeof(cache_header));
+                for (std::size_t i = 0; i < n_tables; ++i)
+                {
+                    file.resize((file.size() + 7) & ~std::size_t(7));
+                    header.tables[i].offset = file.size();
+                    header.tables[i].count = tables_[i].size() / record_sizes[i];
+                    file.insert(file.end(), tables_[i].begin(), tables_[i].end());
+                }
+                std::memcpy(file.data(), &header, sizeof(cache_header));
+
+                std::error_code ec;
+                std::filesystem::create_directories(path.parent_path(), ec);
+
+                auto tmp_path = path;
+                tmp_path += ".tmp." + std::to_string(getpid());
+                {
+                    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+                    if (!out) return false;
+                    out.write(reinterpret_cast<const char*>(file.data()), file.size());
+                    if (!out) return false;
+                }
+
+                std::filesystem::rename(tmp_path, path, ec);
+                if (ec) std::filesystem::remove(tmp_path, ec);
+                return !ec;
+            }
+    };
+}
+
+void sdb::index_cache::set_directory(std::optional<std::filesystem::path> directory)
+{
+    g_cache_directory = std::move(directory);
+}
+
+std::optional<std::filesystem::path> sdb::index_cache::directory()
+{
+    return g_cache_directory;
+}
+
+sdb::index_cache::~index_cache()
+{
+    munmap(data_, size_);
+    close(fd_);
+}
+
+template <class T>
+sdb::span<const T> sdb::index_cache::table(std::size_t index) const
+{
+    auto header = from_bytes<cache_header>(data_);
+    auto location = header.tables[index];
+    return {reinterpret_cast<const T*>(data_ + location.offset), location.count};
+}
+
+std::unique_ptr<sdb::index_cache> sdb::index_cache::open(const elf& obj)
+{
+    auto path = cache_path(obj);
+    if (!path) return nullptr;
+
+    struct stat elf_stats;
+    if (stat(obj.path().c_str(), &elf_stats) < 0) return nullptr;
+
+    int fd = ::open(path->c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat stats;
+    if ((fstat(fd, &stats) < 0) or (static_cast<std::size_t>(stats.st_size) < sizeof(cache_header)))
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    void* ret = mmap(0, stats.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (ret == MAP_FAILED)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    std::unique_ptr<index_cache> cache(new index_cache(fd, reinterpret_cast<std::byte*>(ret), stats.st_size));
+
+    auto header = from_bytes<cache_header>(cache->data_);
+    bool valid = (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) == 0) and (header.version == cache_version) and
+        (header.mtime_sec == elf_stats.st_mtim.tv_sec) and (header.mtime_nsec == elf_stats.st_mtim.tv_nsec) and
+        (header.file_size == static_cast<std::uint64_t>(elf_stats.st_size));
+
+    auto record_sizes = sdb::index_cache::record_sizes();
+    for (std::size_t i = 0; valid and (i < n_tables); ++i)
+    {
+        auto& location = header.tables[i];
+        valid = (location.offset <= cache->size_) and (location.count <= (cache->size_ - location.offset) / record_sizes[i]);
+    }
+
+    if (!valid or !cache->records_valid(obj)) return nullptr;
+    return cache;
+}
+
+bool sdb::index_cache::records_valid(const elf& obj) const
+{
+    auto header = from_bytes<cache_header>(data_);
+    auto n_cus = header.n_compile_units;
+    auto debug_info_size = obj.get_section_contents(".debug_info").size();
+
+    auto strings = table<char>(strings_table);
+    if ((strings.size() > 0) and (strings.end()[-1] != '\0')) return false;
+    auto valid_name = [&](std::uint32_t name) { return name < strings.size(); };
+    auto valid_entry = [&](std::uint32_t cu, std::uint64_t die) { return (cu < n_cus) and (die < debug_info_size); };
+
+    for (auto& record: table<symbol_record>(symbols_table))
+    {
+        if (!valid_name(record.name) or (record.symbol >= obj.symbol_table_.size())) return false;
+    }
+
+    for (auto index: {functions_table, global_variables_table})
+    {
+        for (auto& record: table<name_record>(index))
+        {
+            if (!valid_name(record.name) or !valid_entry(record.cu, record.die)) return false;
+        }
+    }
+
+    for (auto& record: table<member_function_record>(member_functions_table))
+    {
+        if ((record.declaration >= debug_info_size) or !valid_entry(record.cu, record.die)) return false;
+    }
+
+    for (auto& record: table<range_record>(function_ranges_table))
+    {
+        if (!valid_entry(record.cu, record.die)) return false;
+    }
+
+    for (auto& record: table<range_record>(compile_unit_ranges_table))
+    {
+        if (record.cu >= n_cus) return false;
+    }
+
+    auto rows = table<row_record>(line_rows_table);
+    auto sequences = table<line_table::sequence>(line_sequences_table);
+    for (auto& record: table<line_table_record>(line_tables_table))
+    {
+        if ((record.cu >= n_cus) or (record.first_row > rows.size()) or (record.n_rows > rows.size() - record.first_row) or
+            (record.first_sequence > sequences.size()) or (record.n_sequences > sequences.size() - record.first_sequence)) return false;
+
+        for (auto i = record.first_row; i < record.first_row + record.n_rows; ++i)
+        {
+            if ((rows[i].file_index == 0) or (rows[i].file_index > record.n_files)) return false;
+        }
+
+        for (auto i = record.first_sequence; i < record.first_sequence + record.n_sequences; ++i)
+        {
+            if ((sequences[i].first_row > sequences[i].end_row) or (sequences[i].end_row > record.n_rows)) return false;
+        }
+    }
+
+    return true;
+}
+
+std::vector<std::size_t> sdb::index_cache::record_sizes()
+{
+    return {1, sizeof(symbol_record), sizeof(name_record), sizeof(name_record), sizeof(member_function_record), 
+        sizeof(range_record), sizeof(range_record), sizeof(line_table_record), sizeof(row_record), sizeof(line_table::sequence)};
+}
+
+void sdb::index_cache::load_symbols(elf& obj) const
+{
+    auto strings = table<char>(strings_table);
+    for (auto& record: table<symbol_record>(symbols_table))
+    {
+        if (record.symbol >= obj.symbol_table_.size()) continue;
+        obj.symbol_name_map_.insert({std::string_view(strings.begin() + record.name), &obj.symbol_table_[record.symbol]});
+    }
+}
+
+void sdb::index_cache::load_dwarf(const dwarf& dwarf_info) const
+{
+    auto header = from_bytes<cache_header>(data_);
+    auto& cus = dwarf_info.compile_units_;
+    if (header.n_compile_units != cus.size()) return;
+
+    auto debug_info = dwarf_info.elf_->get_section_contents(".debug_info");
+    auto strings = table<char>(strings_table);
+    auto entry_at = [&](std::uint32_t cu, std::uint64_t die) { return dwarf::index_entry{cus[cu].get(), debug_info.begin() + die}; };
+
+    auto in_compile_unit = [&](std::uint32_t cu, std::uint64_t die)
+    {
+        auto data = cus[cu]->data();
+        return (debug_info.begin() + die >= data.begin()) and (debug_info.begin() + die < data.end());
+    };
+
+    for (auto index: {functions_table, global_variables_table})
+    {
+        for (auto& record: table<name_record>(index)) if (!in_compile_unit(record.cu, record.die)) return;
+    }
+    for (auto& record: table<member_function_record>(member_functions_table)) if (!in_compile_unit(record.cu, record.die)) return;
+    for (auto& record: table<range_record>(function_ranges_table)) if (!in_compile_unit(record.cu, record.die)) return;
+
+    std::call_once(dwarf_info.index_once_, [&]
+    {
+        auto functions = table<name_record>(functions_table);
+        dwarf_info.function_index_.reserve(functions.size());
+        for (auto& record: functions) dwarf_info.function_index_.emplace(strings.begin() + record.name, entry_at(record.cu, record.die));
+
+        auto global_variables = table<name_record>(global_variables_table);
+        dwarf_info.global_variable_index_.reserve(global_variables.size());
+        for (auto& record: global_variables) dwarf_info.global_variable_index_.emplace(strings.begin() + record.name, entry_at(record.cu, record.die));
+
+        for (auto& record: table<member_function_record>(member_functions_table))
+        {
+            dwarf_info.member_function_index_.emplace(debug_info.begin() + record.declaration, entry_at(record.cu, record.die));
+        }
+
+        auto function_ranges = table<range_record>(function_ranges_table);
+        dwarf_info.function_range_starts_.reserve(function_ranges.size());
+        dwarf_info.function_ranges_.reserve(function_ranges.size());
+        for (auto& record: function_ranges)
+        {
+            dwarf_info.function_range_starts_.push_back(record.low);
+            dwarf_info.function_ranges_.push_back({record.high, entry_at(record.cu, record.die)});
+        }
+    });
+
+    std::call_once(dwarf_info.compile_unit_ranges_once_, [&]
+    {
+        for (auto& record: table<range_record>(compile_unit_ranges_table))
+        {
+            dwarf_info.compile_unit_range_starts_.push_back(record.low);
+            dwarf_info.compile_unit_ranges_.push_back({record.high, cus[record.cu].get()});
+        }
+    });
+}
+
+void sdb::index_cache::load_line_table(const compile_unit& cu, const line_table& lines) const
+{
+    auto header = from_bytes<cache_header>(data_);
+    auto& dwarf_info = *cu.dwarf_info();
+    if (header.n_compile_units != dwarf_info.compile_units_.size()) return;
+
+    auto debug_info = dwarf_info.elf_->get_section_contents(".debug_info");
+    auto cu_index = dwarf_info.find_compile_unit_at_offset(cu.data().begin() - debug_info.begin());
+    if (!cu_index) return;
+
+    auto records = table<line_table_record>(line_tables_table);
+    auto it = std::lower_bound(records.begin(), records.end(), *cu_index, [](auto& record, auto index) { return record.cu < index; });
+    if ((it == records.end()) or (it->cu != *cu_index)) return;
+    if (lines.file_names_.size() != it->n_files) return;
+
+    auto rows = table<row_record>(line_rows_table);
+    auto sequences = table<line_table::sequence>(line_sequences_table);
+    std::call_once(lines.decode_once_, [&]
+    {
+        lines.rows_.reserve(it->n_rows);
+        for (auto row = rows.begin() + it->first_row; row != rows.begin() + it->first_row + it->n_rows; ++row)
+        {
+            lines.rows_.push_back({row->address, row->file_index, row->line, row->column, row->discriminator, row->flags});
+        }
+        lines.sequences_.assign(sequences.begin() + it->first_sequence, sequences.begin() + it->first_sequence + it->n_sequences);
+        lines.decoded_ = true;
+    });
+}
+
+void sdb::index_cache::store(const elf& obj)
+{
+    auto path = cache_path(obj);
+    if (!path) return;
+
+    struct stat elf_stats;
+    if (stat(obj.path().c_str(), &elf_stats) < 0) return;
+
+    // Only what this session already built is written, so a miss never forces a full index
+    auto& dwarf_info = obj.get_dwarf();
+    if (!dwarf_info.indexed_) return;
+
+    cache_writer writer;
+    auto& cus = dwarf_info.compile_units_;
+    auto debug_info = obj.get_section_contents(".debug_info");
+
+    auto cu_index = [&](const compile_unit* cu)
+    {
+        auto it = std::lower_bound(cus.begin(), cus.end(), cu->data().begin(), [](auto& cu, auto pos) { return cu->data().begin() < pos; });
+        return static_cast<std::uint32_t>(std::distance(cus.begin(), it));
+    };
+    auto die_offset = [&](const std::byte* pos) { return static_cast<std::uint64_t>(pos - debug_info.begin()); };
+
+    try
+    {
+        std::call_once(dwarf_info.compile_unit_ranges_once_, [&] { dwarf_info.build_compile_unit_ranges(); });
+
+        for (auto& [name, symbol]: obj.symbol_name_map_)
+        {
+            if (name.data() == obj.get_string(symbol->st_name).data()) continue;
+            auto index = static_cast<std::uint32_t>(symbol - obj.symbol_table_.data());
+            writer.add(symbols_table, symbol_record{writer.add_string(name), index});
+        }
+
+        for (auto& [name, entry]: dwarf_info.function_index_)
+            writer.add(functions_table, name_record{writer.add_string(name), cu_index(entry.cu), die_offset(entry.pos)});
+
+        for (auto& [name, entry]: dwarf_info.global_variable_index_)
+            writer.add(global_variables_table, name_record{writer.add_string(name), cu_index(entry.cu), die_offset(entry.pos)});
+
+        for (auto& [declaration, entry]: dwarf_info.member_function_index_)
+            writer.add(member_functions_table, member_function_record{die_offset(declaration), die_offset(entry.pos), cu_index(entry.cu), 0});
+
+        for (std::size_t i = 0; i < dwarf_info.function_ranges_.size(); ++i)
+        {
+            auto& range = dwarf_info.function_ranges_[i];
+            writer.add(function_ranges_table, range_record{dwarf_info.function_range_starts_[i], range.high, 
+                die_offset(range.entry.pos), cu_index(range.entry.cu), 0});
+        }
+
+        for (std::size_t i = 0; i < dwarf_info.compile_unit_ranges_.size(); ++i)
+        {
+            auto& range = dwarf_info.compile_unit_ranges_[i];
+            writer.add(compile_unit_ranges_table, range_record{dwarf_info.compile_unit_range_starts_[i], range.high, 0, cu_index(range.cu), 0});
+        }
+
+        for (std::size_t i = 0; i < cus.size(); ++i)
+        {
+            auto& table = cus[i]->line_table_;
+            if (!table or !table->decoded_) continue;
+
+            auto& lines = *table;
+
+            line_table_record record{static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(lines.file_names_.size()), 
+                writer.size(line_rows_table) / sizeof(row_record), lines.rows_.size(),
+                writer.size(line_sequences_table) / sizeof(line_table::sequence), lines.sequences_.size()};
+            writer.add(line_tables_table, record);
+            for (auto& row: lines.rows_)
+            {
+                writer.add(line_rows_table, row_record{row.address, row.file_index, row.line, row.column, row.discriminator, row.flags, {}});
+            }
+            writer.add_all(line_sequences_table, lines.sequences_);
+        }
+
+    } catch (const sdb::error&) {
+
+        return;
+    }
+
+    cache_header header{};
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = cache_version;
+    header.n_compile_units = static_cast<std::uint32_t>(cus.size());
+    header.mtime_sec = elf_stats.st_mtim.tv_sec;
+    header.mtime_nsec = elf_stats.st_mtim.tv_nsec;
+    header.file_size = elf_stats.st_size;
+
+    writer.write(*path, header, record_sizes());
+}
@@ -2,6 +2,7 @@
 #include <libsdb/error.hpp>
 #include <libsdb/pipe.hpp>
 #include <libsdb/target.hpp>
+#include <libsdb/disassembler.hpp>
 #include <sys/ptrace.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -9,13 +10,45 @@
 #include <unistd.h>
 #include <signal.h>
 #include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <climits>
+#include <cstring>
 #include <elf.h>
 #include <fstream>
+#include <algorithm>
+#include <limits>
 
 #include <iostream>
 
 namespace
 {
+    // Statuses that one inferior's waitpid(-1) reaped for a thread it does not own,
+    // kept until the owner asks for that thread
+    std::vector<std::pair<pid_t, int>> g_unclaimed_statuses;
+
+    std::optional<int> take_unclaimed_status(pid_t tid)
+    {
+        auto it = std::find_if(g_unclaimed_statuses.begin(), g_unclaimed_statuses.end(),
+            [=](auto& unclaimed) { return unclaimed.first == tid; });
+        if (it == g_unclaimed_statuses.end()) return std::nullopt;
+
+        auto wait_status = it->second;
+        g_unclaimed_statuses.erase(it);
+        return wait_status;
+    }
+
+    pid_t wait_for_thread(pid_t tid, int* wait_status)
+    {
+        if (auto unclaimed = take_unclaimed_status(tid))
+        {
+            if (wait_status) *wait_status = *unclaimed;
+            return tid;
+        }
+        return waitpid(tid, wait_status, __WALL);
+    }
+
     void exit_with_perror(sdb::pipe& channel, std::string const& prefix)
     {
         auto message = prefix + ": " + std::strerror(errno);
@@ -59,12 +92,96 @@ namespace
         sdb::error::send("No remaining hardware debug registers");
     }
 
-    void set_ptrace_options(pid_t pid)
+    constexpr std::uint64_t syscall_instruction = 0x050f;
+    constexpr std::size_t max_instruction_size = 15;
+    constexpr std::size_t displaced_step_slot_size = 16;
+    constexpr std::size_t displaced_step_area_size = 0x1000;
+    constexpr std::uint64_t displaced_step_area_distance = 0x1000000;
+
+    constexpr std::size_t stack_red_zone_size = 128;
+    constexpr std::size_t initial_stack_snapshot_size = 0x8000;
+    constexpr std::size_t max_stack_snapshot_size = 0x800000;
+
+    constexpr std::size_t page_size = 0x1000;
+
+    using vm_transfer = ssize_t (*)(pid_t, const iovec*, unsigned long, const iovec*, unsigned long, unsigned long);
+
+    ssize_t transfer_process_memory(vm_transfer transfer, pid_t pid, sdb::virt_addr address, std::byte* local, std::size_t amount)
     {
-        if (ptrace(PTRACE_SETOPTIONS, pid, nullptr, PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE) < 0)
+        std::vector<iovec> remote_descs;
+        while (amount > 0)
+        {
+            auto up_to_next_page = page_size - (address.addr() & (page_size - 1));
+            auto chunk_size = std::min(amount, up_to_next_page);
+            remote_descs.push_back({reinterpret_cast<void*>(address.addr()), chunk_size});
+            amount -= chunk_size;
+            address += chunk_size;
+        }
+
+        // The kernel caps a single call at IOV_MAX remote segments
+        ssize_t total = 0;
+        for (std::size_t i = 0; i < remote_descs.size(); i += IOV_MAX)
+        {
+            auto n_descs = std::min<std::size_t>(IOV_MAX, remote_descs.size() - i);
+            std::size_t batch_size = 0;
+            for (std::size_t j = i; j < i + n_descs; ++j) batch_size += remote_descs[j].iov_len;
+
+            iovec local_desc{ local + total, batch_size };
+            auto transferred = transfer(pid, &local_desc, 1, remote_descs.data() + i, n_descs, 0);
+            if (transferred < 0) return (total > 0) ? total : transferred;
+
+            total += transferred;
+            if (static_cast<std::size_t>(transferred) < batch_size) break;
+        }
+
+        return total;
+    }
+
+    ssize_t read_process_memory(pid_t pid, sdb::virt_addr address, std::byte* dest, std::size_t amount)
+    {
+        return transfer_process_memory(process_vm_readv, pid, address, dest, amount);
+    }
+
+    ssize_t write_process_memory(pid_t pid, sdb::virt_addr address, const std::byte* src, std::size_t amount)
+    {
+        return transfer_process_memory(process_vm_writev, pid, address, const_cast<std::byte*>(src), amount);
+    }
+
+    constexpr auto ptrace_options = PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_TRACEEXEC;
+
+    // PTRACE_EVENT_STOP also reports group-stops, which carry the stopping signal rather than SIGTRAP
+    bool is_interrupt_stop(int wait_status)
+    {
+        return (WIFSTOPPED(wait_status) and ((wait_status >> 16) == PTRACE_EVENT_STOP) and (WSTOPSIG(wait_status) == SIGTRAP));
+    }
+
+    bool is_exec_stop(int wait_status)
+    {
+        return (WIFSTOPPED(wait_status) and ((wait_status >> 8) == (SIGTRAP | (PTRACE_EVENT_EXEC << 8))));
+    }
+
+    bool is_single_step_stop(int wait_status)
+    {
+        return (WIFSTOPPED(wait_status) and ((wait_status >> 8) == SIGTRAP));
+    }
+
+    int seize_before_exec(pid_t pid)
+    {
+        int wait_status = 0;
+        if ((waitpid(pid, &wait_status, WUNTRACED) < 0) or !WIFSTOPPED(wait_status)) return wait_status;
+
+        if (ptrace(PTRACE_SEIZE, pid, nullptr, ptrace_options) < 0)
+        {
+            sdb::error::send_errno("Tracing failed");
+        }
+
+        kill(pid, SIGCONT);
+        while ((waitpid(pid, &wait_status, __WALL) >= 0) and WIFSTOPPED(wait_status) and !is_exec_stop(wait_status))
         {
-            sdb::error::send_errno("Failed to set TRACESYSGOOD and TRACECLONE option");
+            ptrace(PTRACE_CONT, pid, nullptr, nullptr);
         }
+
+        return wait_status;
     }
 }
 
@@ -107,13 +224,15 @@ int sdb::process::set_hardware_stoppoint(virt_addr address, stoppoint_mode mode,
     masked |= enable_bit | mode_bits | size_bits;
     regs.write_by_id(register_id::dr7, masked);
 
-    for (auto& [tid, _]: threads_)
+    auto paused = pause_other_threads(current_thread_);
+    for (auto& [tid, thread]: threads_)
     {
-        if (tid == current_thread_) continue;
+        if ((tid == current_thread_) or (thread.state != process_state::stopped)) continue;
         auto& other_regs = get_registers(tid);
         other_regs.write_by_id(static_cast<register_id>(id), address.addr());
         other_regs.write_by_id(register_id::dr7, masked);
     }
+    resume_paused_threads(paused);
 
     return free_space;
 }
@@ -134,13 +253,15 @@ void sdb::process::clear_hardware_stoppoint(int index)
 
     get_registers().write_by_id(register_id::dr7, masked);
 
-    for (auto& [tid, _]: threads_)
+    auto paused = pause_other_threads(current_thread_);
+    for (auto& [tid, thread]: threads_)
     {
-        if (tid == current_thread_) continue;
+        if ((tid == current_thread_) or (thread.state != process_state::stopped)) continue;
         auto& other_regs = get_registers(tid);
         other_regs.write_by_id(static_cast<register_id>(id), 0);
         other_regs.write_by_id(register_id::dr7, masked);
     }
+    resume_paused_threads(paused);
 }
 
 std::unique_ptr<sdb::process> sdb::process::launch(std::filesystem::path path, bool debug, std::optional<int> stdout_replacement)
@@ -170,7 +291,7 @@ std::unique_ptr<sdb::process> sdb::process::launch(std::filesystem::path path, b
             }
         }
 
-        if (debug && (ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) < 0))
+        if (debug && (raise(SIGSTOP) < 0))
         {
             exit_with_perror(channel, "Tracing failed");
         }
@@ -182,6 +303,8 @@ std::unique_ptr<sdb::process> sdb::process::launch(std::filesystem::path path, b
     }
 
     channel.close_write();
+    int exec_wait_status = 0;
+    if (debug) exec_wait_status = seize_before_exec(pid);
     auto data = channel.read();
     channel.close_read();
 
@@ -195,8 +318,7 @@ std::unique_ptr<sdb::process> sdb::process::launch(std::filesystem::path path, b
     std::unique_ptr<process> proc(new process(pid, true, debug));
     if (debug)
     {
-        proc->wait_on_signal();
-        set_ptrace_options(proc->pid());
+        proc->handle_wait_status(pid, exec_wait_status, pid);
     }
 
     return proc;
@@ -209,14 +331,28 @@ std::unique_ptr<sdb::process> sdb::process::attach(pid_t pid)
         error::send("Invalid PID");
     }
 
-    if (ptrace(PTRACE_ATTACH, pid, nullptr, nullptr) < 0)
+    if (ptrace(PTRACE_SEIZE, pid, nullptr, ptrace_options) < 0)
     {
         error::send_errno("Could not attach");
     }
 
     std::unique_ptr<process> proc(new process(pid, false, true));
-    proc->wait_on_signal();
-    set_ptrace_options(proc->pid());
+    for (auto it = proc->threads_.begin(); it != proc->threads_.end();)
+    {
+        auto& [tid, thread] = *it;
+        if ((tid != pid) and (ptrace(PTRACE_SEIZE, tid, nullptr, ptrace_options) < 0))
+        {
+            it = proc->threads_.erase(it);
+            continue;
+        }
+
+        thread.state = process_state::running;
+        ++it;
+    }
+
+    proc->state_ = process_state::running;
+    proc->interrupt(pid);
+    proc->wait_on_signal(pid);
 
     return proc;
 }
@@ -228,20 +364,41 @@ sdb::process::~process()
         int status;
         if (is_attached_)
         {
-            if (state_ == process_state::running)
+            for (auto& [tid, thread]: threads_)
             {
-                kill(pid_, SIGSTOP);
-                waitpid(pid_, &status, 0);
-            }
+                if (thread.state == process_state::running)
+                {
+                    ptrace(PTRACE_INTERRUPT, tid, nullptr, nullptr);
+                    wait_for_thread(tid, &status);
+                }
 
-            ptrace(PTRACE_DETACH, pid_, nullptr, nullptr);
-            kill(pid_, SIGCONT);
+                ptrace(PTRACE_DETACH, tid, nullptr, nullptr);
+            }
         }
 
+        if (memory_fd_ >= 0) close(memory_fd_);
+
+        g_unclaimed_statuses.erase(std::remove_if(g_unclaimed_statuses.begin(), g_unclaimed_statuses.end(),
+            [&](auto& unclaimed) { return owns_thread(unclaimed.first); }), g_unclaimed_statuses.end());
+
         if (terminate_on_end_)
         {
+            // Threads that are still traced, such as ones never reported to us, have to be
+            // reaped before the leader can be
+            std::vector<pid_t> tids;
+            std::error_code ec;
+            for (auto& entry: std::filesystem::directory_iterator("/proc/" + std::to_string(pid_) + "/task", ec))
+            {
+                auto tid = std::stoi(entry.path().filename().string());
+                if (tid != pid_) tids.push_back(tid);
+            }
+            tids.push_back(pid_);
+
             kill(pid_, SIGKILL);
-            waitpid(pid_, &status, 0);
+            for (auto tid: tids)
+            {
+                while ((waitpid(tid, &status, __WALL) == tid) and !WIFEXITED(status) and !WIFSIGNALED(status));
+            }
         }
     }
 }
@@ -249,12 +406,18 @@ sdb::process::~process()
 void sdb::process::resume(std::optional<pid_t> otid)
 {
     auto tid = otid.value_or(current_thread_);
+
+    // The next wait reports the stop the thread is still sitting on
+    if (has_pending_stop(tid)) return;
+
     step_over_breakpoint(tid);
-    send_continue(tid);
+    if (!has_pending_stop(tid)) send_continue(tid);
 }
 
 void sdb::process::send_continue(pid_t tid)
 {
+    invalidate_memory_caches();
+
     auto request = (syscall_catch_policy_.get_mode() == syscall_catch_policy::mode::none) ? PTRACE_CONT : PTRACE_SYSCALL;
     if (ptrace(request, tid, nullptr, nullptr) < 0)
     {
@@ -262,66 +425,360 @@ void sdb::process::send_continue(pid_t tid)
     }
 
     threads_.at(tid).state = process_state::running;
-    state_ = process_state::running;
+    threads_.at(tid).registers_stale = true;
+
+    auto any_stopped = std::any_of(threads_.begin(), threads_.end(),
+        [](auto& t) { return t.second.state == process_state::stopped; });
+    if (!non_stop_ or !any_stopped) state_ = process_state::running;
+}
+
+std::vector<pid_t> sdb::process::pause_other_threads(pid_t tid)
+{
+    std::vector<pid_t> paused;
+    if (!non_stop_) return paused;
+
+    for (auto& [other_tid, thread]: threads_)
+    {
+        if ((other_tid == tid) or (thread.state != process_state::running)) continue;
+
+        if (!thread.pending_interrupt) ptrace(PTRACE_INTERRUPT, other_tid, nullptr, nullptr);
+
+        while (true)
+        {
+            int wait_status;
+            if (wait_for_thread(other_tid, &wait_status) < 0) error::send_errno("waitpid failed");
+
+            if (is_interrupt_stop(wait_status))
+            {
+                thread.pending_interrupt = false;
+                thread.state = process_state::stopped;
+                paused.push_back(other_tid);
+                break;
+            }
+
+            // Spawning a thread is not a stop of its own, so let the interrupt land instead
+            if (stop_reason(other_tid, wait_status).trap_reason == trap_type::clone)
+            {
+                track_new_thread(other_tid);
+                ptrace(PTRACE_CONT, other_tid, nullptr, nullptr);
+                continue;
+            }
+
+            // The thread hit something real before the interrupt landed, so it stays
+            // stopped on that event until the next wait reports it
+            thread.pending_interrupt = WIFSTOPPED(wait_status);
+            defer_stop(other_tid, wait_status);
+            break;
+        }
+    }
+
+    return paused;
+}
+
+void sdb::process::resume_paused_threads(const std::vector<pid_t>& paused)
+{
+    for (auto tid: paused) send_continue(tid);
+}
+
+void sdb::process::defer_stop(pid_t tid, int wait_status)
+{
+    // Handled now, while the registers still describe the event, and reported later
+    stop_reason reason(tid, wait_status);
+    reason = handle_signal(reason, false).value_or(reason);
+
+    auto& thread = threads_.at(tid);
+    thread.reason = reason;
+    thread.state = reason.reason;
+    pending_stops_.push_back(reason);
+}
+
+bool sdb::process::has_pending_stop(pid_t tid) const
+{
+    return std::any_of(pending_stops_.begin(), pending_stops_.end(), [=](auto& reason) { return reason.tid == tid; });
+}
+
+pid_t sdb::process::memory_access_tid() const
+{
+    auto is_stopped = [&](pid_t tid) {
+        auto it = threads_.find(tid);
+        return (it == threads_.end()) or (it->second.state == process_state::stopped);
+    };
+
+    if (is_stopped(pid_)) return pid_;
+    if (is_stopped(current_thread_)) return current_thread_;
+
+    for (auto& [tid, thread]: threads_)
+    {
+        if (thread.state == process_state::stopped) return tid;
+    }
+    return pid_;
 }
 
 void sdb::process::step_over_breakpoint(pid_t tid)
 {
-    auto pc = get_pc(tid);
+    step_over_breakpoints({tid});
+}
 
-    if (breakpoint_sites_.enabled_stoppoint_at_address(pc))
+void sdb::process::step_over_breakpoints(const std::vector<pid_t>& tids)
+{
+    std::vector<displaced_step> displaced;
+    std::vector<pid_t> in_place;
+    for (auto tid: tids)
+    {
+        // A thread whose registers were not read since it last ran cannot be sitting on a known hit
+        if (threads_.at(tid).registers_stale or !breakpoint_sites_.enabled_stoppoint_at_address(get_pc(tid))) continue;
+
+        auto step = displaced_stepping_ ? prepare_displaced_step(tid, displaced.size()) : std::nullopt;
+        if (step) displaced.push_back(*step);
+        else if (!has_pending_stop(tid)) in_place.push_back(tid);
+    }
+
+    // Displaced steps leave the int3s in place, so they can all be in flight at once
+    invalidate_memory_caches();
+    for (auto& step: displaced)
+    {
+        if (ptrace(PTRACE_SINGLESTEP, step.tid, nullptr, nullptr) < 0)
+        {
+            error::send_errno("Failed to single step");
+        }
+    }
+
+    for (auto& step: displaced)
+    {
+        auto interrupted = false;
+        auto wait_status = wait_for_single_step(step.tid, interrupted);
+        if (WIFSTOPPED(wait_status)) finish_displaced_step(step);
+
+        // Anything other than the step's own trap is an event to report, not a finished step
+        if (!is_single_step_stop(wait_status)) defer_stop(step.tid, wait_status);
+        else if (interrupted) interrupt(step.tid);
+    }
+
+    for (auto tid: in_place)
     {
-        auto& bp = breakpoint_sites_.get_by_address(pc);
+        auto paused = pause_other_threads(tid);
+        auto& bp = breakpoint_sites_.get_by_address(get_pc(tid));
         bp.disable();
-        swallow_pending_sigstop(tid);
+
         if (ptrace(PTRACE_SINGLESTEP, tid, nullptr, nullptr) < 0)
         {
             error::send_errno("Failed to single step");
         }
 
+        auto interrupted = false;
+        auto wait_status = wait_for_single_step(tid, interrupted);
+        threads_.at(tid).registers_stale = true;
+
+        bp.enable();
+        if (!is_single_step_stop(wait_status)) defer_stop(tid, wait_status);
+        else if (interrupted) interrupt(tid);
+        resume_paused_threads(paused);
+    }
+}
+
+int sdb::process::wait_for_single_step(pid_t tid, bool& interrupted)
+{
+    while (true)
+    {
         int wait_status;
-        if (waitpid(tid, &wait_status, 0) < 0)
+        if (wait_for_thread(tid, &wait_status) < 0)
         {
             error::send_errno("waitpid failed");
         }
 
-        bp.enable();
+        if (!is_interrupt_stop(wait_status)) return wait_status;
+
+        if (threads_.at(tid).pending_interrupt) threads_.at(tid).pending_interrupt = false;
+        else interrupted = true;
+
+        if (ptrace(PTRACE_SINGLESTEP, tid, nullptr, nullptr) < 0)
+        {
+            error::send_errno("Failed to single step");
+        }
+    }
+}
+
+std::optional<sdb::virt_addr> sdb::process::displaced_step_area(pid_t tid)
+{
+    if (displaced_step_area_ or displaced_step_area_failed_) return displaced_step_area_;
+    displaced_step_area_failed_ = true;
+
+    auto auxv = get_auxv();
+    if (!auxv.count(AT_ENTRY)) return std::nullopt;
+    auto entry = auxv[AT_ENTRY];
+
+    // Have the thread run an mmap syscall planted at the entry point, which has
+    // already run by the time any breakpoint can be hit
+    user_regs_struct saved_regs;
+    if (ptrace(PTRACE_GETREGS, tid, nullptr, &saved_regs) < 0) return std::nullopt;
+
+    errno = 0;
+    auto saved_code = ptrace(PTRACE_PEEKDATA, tid, entry, nullptr);
+    if (errno != 0) return std::nullopt;
+
+    auto syscall_code = (static_cast<std::uint64_t>(saved_code) & ~0xffffull) | syscall_instruction;
+    if (ptrace(PTRACE_POKEDATA, tid, entry, syscall_code) < 0) return std::nullopt;
+
+    auto regs = saved_regs;
+    regs.rip = entry;
+    regs.rax = SYS_mmap;
+    regs.orig_rax = -1;
+    regs.rdi = (entry > displaced_step_area_distance) ? ((entry - displaced_step_area_distance) & ~0xfffull) : 0;
+    regs.rsi = displaced_step_area_size;
+    regs.rdx = PROT_READ | PROT_EXEC;
+    regs.r10 = MAP_PRIVATE | MAP_ANONYMOUS;
+    regs.r8 = -1;
+    regs.r9 = 0;
+
+    auto interrupted = false;
+    std::optional<int> wait_status;
+    if ((ptrace(PTRACE_SETREGS, tid, nullptr, &regs) == 0) and (ptrace(PTRACE_SINGLESTEP, tid, nullptr, nullptr) == 0))
+    {
+        wait_status = wait_for_single_step(tid, interrupted);
+    }
+    auto stepped = wait_status and is_single_step_stop(*wait_status) and (ptrace(PTRACE_GETREGS, tid, nullptr, &regs) == 0);
+
+    ptrace(PTRACE_POKEDATA, tid, entry, saved_code);
+    ptrace(PTRACE_SETREGS, tid, nullptr, &saved_regs);
+
+    // The thread stopped for something else first, so report that and try again next time
+    if (wait_status and !is_single_step_stop(*wait_status))
+    {
+        displaced_step_area_failed_ = false;
+        defer_stop(tid, *wait_status);
+        return std::nullopt;
+    }
+    if (interrupted) interrupt(tid);
+
+    // Negative errno values come back in the top page of the address space
+    if (!stepped or (regs.rax > -4096ull)) return std::nullopt;
+
+    displaced_step_area_ = virt_addr{regs.rax};
+    return displaced_step_area_;
+}
+
+std::optional<sdb::process::displaced_step> sdb::process::prepare_displaced_step(pid_t tid, std::size_t slot_index)
+{
+    if (slot_index >= displaced_step_area_size / displaced_step_slot_size) return std::nullopt;
+
+    auto area = displaced_step_area(tid);
+    if (!area) return std::nullopt;
+
+    auto from = get_pc(tid);
+    auto code = read_memory_without_traps(from, max_instruction_size);
+    auto layout = disassembler::decode_layout({code.data(), code.size()});
+    if (!layout) return std::nullopt;
+
+    code.resize(layout->length);
+    auto slot = *area + slot_index * displaced_step_slot_size;
+
+    if (layout->rip_displacement_offset)
+    {
+        auto offset = *layout->rip_displacement_offset;
+        auto rebased = from_bytes<std::int32_t>(code.data() + offset) + static_cast<std::int64_t>(from.addr() - slot.addr());
+        if ((rebased < std::numeric_limits<std::int32_t>::min()) or (rebased > std::numeric_limits<std::int32_t>::max())) return std::nullopt;
+
+        auto narrowed = static_cast<std::int32_t>(rebased);
+        std::memcpy(code.data() + offset, &narrowed, sizeof(narrowed));
+    }
+
+    write_memory(slot, {code.data(), code.size()});
+    set_pc(slot, tid);
+
+    return displaced_step{tid, from, slot, layout->length, layout->is_call, layout->is_absolute_branch};
+}
+
+void sdb::process::finish_displaced_step(const displaced_step& step)
+{
+    read_all_registers(step.tid);
+
+    auto pc = get_pc(step.tid);
+    auto offset = static_cast<std::int64_t>(step.from.addr() - step.slot.addr());
+    auto in_slot = (step.slot <= pc) and (pc <= step.slot + step.length);
+
+    // Relative branches and fall-throughs land relative to the slot, absolute branches do not
+    if (in_slot or !step.is_absolute_branch) set_pc(pc + offset, step.tid);
+
+    if (step.is_call and !in_slot)
+    {
+        auto rsp = virt_addr{get_registers(step.tid).read_by_id_as<std::uint64_t>(register_id::rsp)};
+        if (read_memory_as<std::uint64_t>(rsp) == (step.slot + step.length).addr())
+        {
+            auto return_address = (step.from + step.length).addr();
+            write_memory(rsp, {reinterpret_cast<const std::byte*>(&return_address), sizeof(return_address)});
+        }
     }
 }
 
-void sdb::process::swallow_pending_sigstop(pid_t tid)
+void sdb::process::swallow_pending_interrupt(pid_t tid)
 {
-    if (threads_.at(tid).pending_sigstop)
+    if (threads_.at(tid).pending_interrupt)
     {
         ptrace(PTRACE_CONT, tid, nullptr, nullptr);
-        waitpid(tid, nullptr, 0);
-        threads_.at(tid).pending_sigstop = false;
+        wait_for_thread(tid, nullptr);
+        threads_.at(tid).pending_interrupt = false;
+    }
+}
+
+void sdb::process::interrupt(std::optional<pid_t> otid)
+{
+    auto tid = otid.value_or(pid_);
+    if (ptrace(PTRACE_INTERRUPT, tid, nullptr, nullptr) < 0)
+    {
+        error::send_errno("Could not interrupt");
     }
 }
 
 sdb::stop_reason sdb::process::step_instruction(std::optional<pid_t> otid)
 {
     auto tid = otid.value_or(current_thread_);
+
+    // The thread is still sitting on a stop that was not reported yet
+    if (has_pending_stop(tid)) return wait_on_signal(tid);
+    swallow_pending_interrupt(tid);
+
     std::optional<breakpoint_site*> to_reenable;
+    std::optional<displaced_step> displaced;
+    std::vector<pid_t> paused;
     auto pc = get_pc(tid);
     if (breakpoint_sites_.enabled_stoppoint_at_address(pc))
     {
-        auto& bp = breakpoint_sites_.get_by_address(pc);
-        bp.disable();
-        to_reenable = &bp;
+        if (displaced_stepping_) displaced = prepare_displaced_step(tid, 0);
+        if (has_pending_stop(tid)) return wait_on_signal(tid);
+
+        if (!displaced)
+        {
+            paused = pause_other_threads(tid);
+            auto& bp = breakpoint_sites_.get_by_address(pc);
+            bp.disable();
+            to_reenable = &bp;
+        }
     }
 
-    swallow_pending_sigstop(tid);
+    invalidate_memory_caches();
     if (ptrace(PTRACE_SINGLESTEP, tid, nullptr, nullptr) < 0)
     {
         error::send_errno("Could not single step");
     }
+
+    if (displaced)
+    {
+        int wait_status;
+        if (wait_for_thread(tid, &wait_status) < 0) error::send_errno("waitpid failed");
+        if (WIFSTOPPED(wait_status)) finish_displaced_step(*displaced);
+
+        auto to_await = tid;
+        if (auto reason = handle_wait_status(tid, wait_status, to_await)) return *reason;
+        return wait_on_signal(to_await);
+    }
+
     auto reason = wait_on_signal(tid);
 
     if (to_reenable)
     {
         to_reenable.value()->enable();
     }
+    resume_paused_threads(paused);
 
     return reason;
 }
@@ -329,6 +786,7 @@ sdb::stop_reason sdb::process::step_instruction(std::optional<pid_t> otid)
 sdb::stop_reason::stop_reason(pid_t tid, int wait_status): tid(tid)
 {
     if((wait_status >> 8) == (SIGTRAP | (PTRACE_EVENT_CLONE << 8))) trap_reason = trap_type::clone;
+    if (is_interrupt_stop(wait_status)) trap_reason = trap_type::interrupt;
 
     if (WIFEXITED(wait_status))
     {
@@ -349,25 +807,106 @@ sdb::stop_reason::stop_reason(pid_t tid, int wait_status): tid(tid)
 
 sdb::stop_reason sdb::process::wait_on_signal(pid_t to_await)
 {
-    int wait_status;
-    int options = __WALL;
-    pid_t tid;
+    return *wait_for_stop(to_await, 0);
+}
+
+std::optional<sdb::stop_reason> sdb::process::poll_signal()
+{
+    return wait_for_stop(-1, WNOHANG);
+}
+
+std::optional<sdb::stop_reason> sdb::process::wait_for_stop(pid_t to_await, int options)
+{
+    while (true)
+    {
+        auto pending = std::find_if(pending_stops_.begin(), pending_stops_.end(),
+            [&](auto& reason) { return (to_await == -1) or (reason.tid == to_await); });
+
+        if (pending != pending_stops_.end())
+        {
+            auto reason = *pending;
+            pending_stops_.erase(pending);
+            if (auto reported = report_stop(reason, to_await)) return reported;
+            continue;
+        }
+
+        int wait_status;
+        auto tid = (to_await == -1) ? poll_threads(wait_status, options) : wait_for_thread(to_await, &wait_status);
+
+        if (tid < 0)
+        {
+            if ((errno == ECHILD) and (options & WNOHANG)) return std::nullopt;
+            error::send_errno("waitpid failed");
+        }
+
+        if (tid == 0) return std::nullopt;
+
+        if (auto reason = handle_wait_status(tid, wait_status, to_await)) return reason;
+    }
+}
+
+bool sdb::process::owns_thread(pid_t tid) const
+{
+    return (tid == pid_) or threads_.count(tid) or
+        (std::find(announced_threads_.begin(), announced_threads_.end(), tid) != announced_threads_.end());
+}
+
+bool sdb::process::has_pending_stops() const
+{
+    return !pending_stops_.empty() or std::any_of(g_unclaimed_statuses.begin(), g_unclaimed_statuses.end(),
+        [&](auto& unclaimed) { return owns_thread(unclaimed.first); });
+}
+
+pid_t sdb::process::poll_threads(int& wait_status, int options)
+{
+    auto unclaimed = std::find_if(g_unclaimed_statuses.begin(), g_unclaimed_statuses.end(),
+        [&](auto& unclaimed) { return owns_thread(unclaimed.first); });
 
-    if ((tid = waitpid(to_await, &wait_status, options)) < 0)
+    if (unclaimed != g_unclaimed_statuses.end())
     {
-        error::send_errno("waitpid failed");
+        auto tid = unclaimed->first;
+        wait_status = unclaimed->second;
+        g_unclaimed_statuses.erase(unclaimed);
+        return tid;
     }
 
+    // One waitpid(-1) per event however many threads there are. A thread whose clone has not been
+    // seen yet is found through our task directory, events of other inferiors are set aside for them
+    auto task_directory = "/proc/" + std::to_string(pid_) + "/task/";
+    while (true)
+    {
+        auto tid = waitpid(-1, &wait_status, options | __WALL);
+        if ((tid <= 0) or owns_thread(tid)) return tid;
+        if (std::filesystem::exists(task_directory + std::to_string(tid))) return tid;
+        g_unclaimed_statuses.emplace_back(tid, wait_status);
+    }
+}
+
+void sdb::process::track_new_thread(pid_t parent)
+{
+    // The new thread's first stop can only be polled for once its tid is known
+    unsigned long new_tid;
+    if (ptrace(PTRACE_GETEVENTMSG, parent, nullptr, &new_tid) < 0) return;
+    if (!threads_.count(new_tid)) announced_threads_.push_back(static_cast<pid_t>(new_tid));
+}
+
+std::optional<sdb::stop_reason> sdb::process::handle_wait_status(pid_t tid, int wait_status, pid_t& to_await)
+{
     stop_reason reason(tid, wait_status);
     auto final_reason = handle_signal(reason, true);
 
     if (!final_reason)
     {
         resume(tid);
-        return wait_on_signal(to_await);
+        return std::nullopt;
     }
 
-    reason = *final_reason;
+    return report_stop(*final_reason, to_await);
+}
+
+std::optional<sdb::stop_reason> sdb::process::report_stop(stop_reason reason, pid_t& to_await)
+{
+    auto tid = reason.tid;
     auto& thread = threads_.at(tid);
     thread.reason = reason;
     thread.state = reason.reason;
@@ -383,11 +922,12 @@ sdb::stop_reason sdb::process::wait_on_signal(pid_t to_await)
 
         } else {
 
-            return wait_on_signal(-1);
+            to_await = -1;
+            return std::nullopt;
         }
     }
 
-    stop_running_threads();
+    if (!non_stop_) stop_running_threads();
     reason = cleanup_exited_threads(tid).value_or(reason);
 
     state_ = reason.reason;
@@ -399,6 +939,7 @@ std::optional<sdb::stop_reason> sdb::process::handle_signal(stop_reason reason,
 {
     auto tid = reason.tid;
 
+    if (reason.trap_reason == trap_type::clone) track_new_thread(tid);
     if (reason.trap_reason && (*reason.trap_reason == trap_type::clone) && is_main_stop) return std::nullopt;
 
     if (is_attached_ && (reason.reason == process_state::stopped))
@@ -406,13 +947,14 @@ std::optional<sdb::stop_reason> sdb::process::handle_signal(stop_reason reason,
         if (!threads_.count(tid))
         {
             threads_.emplace(tid, thread_state{tid, registers(*this, tid)});
+            announced_threads_.erase(std::remove(announced_threads_.begin(), announced_threads_.end(), tid), announced_threads_.end());
             report_thread_lifecycle_event(reason);
             if (is_main_stop) return std::nullopt;
         }
 
-        if (threads_.at(tid).pending_sigstop && (reason.info == SIGSTOP))
+        if (threads_.at(tid).pending_interrupt && (reason.trap_reason == trap_type::interrupt))
         {
-            threads_.at(tid).pending_sigstop = false;
+            threads_.at(tid).pending_interrupt = false;
             return std::nullopt;
         }
 
@@ -466,7 +1008,8 @@ std::optional<sdb::stop_reason> sdb::process::cleanup_exited_threads(pid_t main_
     std::optional<stop_reason> to_report;
     for (auto& [tid, thread]: threads_)
     {
-        if ((tid != main_stop_tid) && ((thread.state == process_state::exited) or (thread.state == process_state::terminated)))
+        if ((tid != main_stop_tid) && ((thread.state == process_state::exited) or (thread.state == process_state::terminated))
+            && !has_pending_stop(tid))
         {
             report_thread_lifecycle_event(thread.reason);
             to_remove.push_back(tid);
@@ -485,15 +1028,14 @@ void sdb::process::stop_running_threads()
     {
         if (thread.state == process_state::running)
         {
-            if (!thread.pending_sigstop) tgkill(pid_, tid, SIGSTOP);
+            if (!thread.pending_interrupt) ptrace(PTRACE_INTERRUPT, tid, nullptr, nullptr);
 
             int wait_status;
-            waitpid(tid, &wait_status, 0);
+            wait_for_thread(tid, &wait_status);
             stop_reason thread_reason(tid, wait_status);
             if (thread_reason.reason == process_state::stopped)
             {
-                if (thread_reason.info != SIGSTOP) thread.pending_sigstop = true;
-                else if (thread.pending_sigstop) thread.pending_sigstop = false;
+                thread.pending_interrupt = (thread_reason.trap_reason != trap_type::interrupt);
             }
 
             thread_reason = handle_signal(thread_reason, false).value_or(thread_reason);
@@ -505,12 +1047,23 @@ void sdb::process::stop_running_threads()
 
 void sdb::process::resume_all_threads()
 {
-    for (auto& [tid, _]: threads_) step_over_breakpoint(tid);
-    for (auto& [tid, _]: threads_) send_continue(tid);
+    std::vector<pid_t> to_resume;
+    for (auto& [tid, thread]: threads_)
+    {
+        if ((thread.state == process_state::stopped) and !has_pending_stop(tid)) to_resume.push_back(tid);
+    }
+
+    step_over_breakpoints(to_resume);
+    for (auto tid: to_resume)
+    {
+        if (!has_pending_stop(tid)) send_continue(tid);
+    }
 }
 
 void sdb::process::read_all_registers(pid_t tid)
 {
+    threads_.at(tid).registers_stale = false;
+
     if (ptrace(PTRACE_GETREGS, tid, nullptr, &get_registers(tid).data_.regs) < 0)
     {
         error::send_errno("Could not read GPR registers");
@@ -537,25 +1090,181 @@ void sdb::process::read_all_registers(pid_t tid)
 
 std::vector<std::byte> sdb::process::read_memory(virt_addr address, std::size_t amount) const
 {
+    if (auto cached = find_in_stack_snapshots(address, amount))
+    {
+        return std::vector<std::byte>(cached, cached + amount);
+    }
+
     std::vector<std::byte> ret(amount);
+    if (read_cached_pages(address, ret.data(), amount)) return ret;
+
+    if (read_process_memory(pid_, address, ret.data(), ret.size()) < 0)
+    {
+        error::send_errno("Could not read process memory");
+    }
+
+    return ret;
+}
 
-    iovec local_desc{ ret.data(), ret.size() };
+std::vector<sdb::process::memory_read_result> sdb::process::read_memory_batch(span<const memory_read_request> requests) const
+{
+    std::vector<memory_read_result> results(requests.size());
+
+    std::vector<iovec> local_descs;
     std::vector<iovec> remote_descs;
+    std::vector<std::size_t> owners;
+    for (std::size_t i = 0; i < requests.size(); ++i)
+    {
+        auto [address, amount] = requests[i];
+        auto& data = results[i].data;
+        data.resize(amount);
+
+        if (auto cached = find_in_stack_snapshots(address, amount))
+        {
+            std::copy(cached, cached + amount, data.begin());
+            continue;
+        }
+        if (read_cached_pages(address, data.data(), amount)) continue;
+
+        // Page-sized segments let a fault be pinned to the request that caused it
+        auto local = data.data();
+        while (amount > 0)
+        {
+            auto up_to_next_page = page_size - (address.addr() & (page_size - 1));
+            auto chunk_size = std::min(amount, up_to_next_page);
+            local_descs.push_back({local, chunk_size});
+            remote_descs.push_back({reinterpret_cast<void*>(address.addr()), chunk_size});
+            owners.push_back(i);
+            local += chunk_size;
+            address += chunk_size;
+            amount -= chunk_size;
+        }
+    }
+
+    std::size_t next = 0;
+    while (next < remote_descs.size())
+    {
+        auto n_descs = std::min<std::size_t>(IOV_MAX, remote_descs.size() - next);
+        auto transferred = process_vm_readv(pid_, local_descs.data() + next, n_descs, remote_descs.data() + next, n_descs, 0);
+        if ((transferred < 0) and (errno != EFAULT))
+        {
+            error::send_errno("Could not read process memory");
+        }
+
+        // Segments are consumed whole, so the first one left over is the one that faulted
+        auto remaining = static_cast<std::size_t>(std::max<ssize_t>(transferred, 0));
+        auto end = next + n_descs;
+        while ((next < end) and (remaining >= remote_descs[next].iov_len))
+        {
+            remaining -= remote_descs[next].iov_len;
+            ++next;
+        }
+        if (next == end) continue;
+
+        auto faulted = owners[next];
+        auto& result = results[faulted];
+        result.error = EFAULT;
+        result.data.resize(static_cast<std::byte*>(local_descs[next].iov_base) - result.data.data());
+        while ((next < owners.size()) and (owners[next] == faulted)) ++next;
+    }
+
+    return results;
+}
+
+bool sdb::process::memory_is_stable() const
+{
+    // Memory is only stable while nothing in the inferior can run
+    auto any_running = std::any_of(threads_.begin(), threads_.end(),
+        [](auto& t) { return t.second.state == process_state::running; });
+    return (state_ == process_state::stopped) and !any_running;
+}
+
+bool sdb::process::read_cached_pages(virt_addr address, std::byte* dest, std::size_t amount) const
+{
+    if (!memory_cache_enabled_ or !memory_is_stable()) return false;
+
     while (amount > 0)
     {
-        auto up_to_next_page = 0x1000 - (address.addr() & 0xfff);
-        auto chunk_size = std::min(amount, up_to_next_page);
-        remote_descs.push_back({reinterpret_cast<void*>(address.addr()), chunk_size});
-        amount -= chunk_size;
-        address += chunk_size;
+        auto page = address.addr() & ~(page_size - 1);
+        auto offset = address.addr() - page;
+        auto chunk = std::min(amount, page_size - offset);
+
+        auto it = memory_pages_.find(page);
+        if (it == memory_pages_.end())
+        {
+            std::vector<std::byte> data(page_size);
+            if (read_process_memory(pid_, virt_addr{page}, data.data(), page_size) != static_cast<ssize_t>(page_size)) return false;
+
+            ++memory_cache_stats_.misses;
+            it = memory_pages_.emplace(page, std::move(data)).first;
+
+        } else {
+
+            ++memory_cache_stats_.hits;
+        }
+
+        std::memcpy(dest, it->second.data() + offset, chunk);
+        dest += chunk;
+        address += chunk;
+        amount -= chunk;
     }
 
-    if (process_vm_readv(pid_, &local_desc, 1, remote_descs.data(), remote_descs.size(), 0) < 0)
+    return true;
+}
+
+void sdb::process::snapshot_stack(std::optional<pid_t> otid)
+{
+    if (!memory_is_stable()) return;
+
+    auto rsp = get_registers(otid).read_by_id_as<std::uint64_t>(register_id::rsp);
+    auto start = virt_addr{rsp - stack_red_zone_size};
+
+    for (auto& snapshot: stack_snapshots_)
     {
-        error::send_errno("Could not read process memory");
+        if ((start >= snapshot.start) and (start.addr() < snapshot.start.addr() + snapshot.data.size())) return;
     }
 
-    return ret;
+    stack_snapshot snapshot{start, {}};
+    extend_stack_snapshot(snapshot, initial_stack_snapshot_size);
+    if (!snapshot.data.empty()) stack_snapshots_.push_back(std::move(snapshot));
+}
+
+const std::byte* sdb::process::find_in_stack_snapshots(virt_addr address, std::size_t amount) const
+{
+    if (!memory_is_stable()) return nullptr;
+
+    for (auto& snapshot: stack_snapshots_)
+    {
+        if (address < snapshot.start) continue;
+
+        auto offset = address.addr() - snapshot.start.addr();
+        if (offset >= 2 * snapshot.data.size()) continue;
+
+        auto needed = offset + amount;
+        if ((needed > snapshot.data.size()) and !extend_stack_snapshot(snapshot, needed)) return nullptr;
+
+        return snapshot.data.data() + offset;
+    }
+
+    return nullptr;
+}
+
+bool sdb::process::extend_stack_snapshot(stack_snapshot& snapshot, std::size_t needed) const
+{
+    if (snapshot.at_end or (needed > max_stack_snapshot_size)) return false;
+
+    auto old_size = snapshot.data.size();
+    auto new_size = std::min(std::max(needed, 2 * old_size), max_stack_snapshot_size);
+    snapshot.data.resize(new_size);
+
+    auto read = read_process_memory(pid_, snapshot.start + old_size, snapshot.data.data() + old_size, new_size - old_size);
+    if (read < static_cast<ssize_t>(new_size - old_size))
+    {
+        snapshot.data.resize(old_size + std::max<ssize_t>(read, 0));
+        snapshot.at_end = true;
+    }
+
+    return (snapshot.data.size() >= needed);
 }
 
 std::vector<std::byte> sdb::process::read_memory_without_traps(virt_addr address, std::size_t amount) const
@@ -574,7 +1283,21 @@ std::vector<std::byte> sdb::process::read_memory_without_traps(virt_addr address
 
 void sdb::process::write_memory(virt_addr address, span<const std::byte> data)
 {
+    invalidate_memory_caches();
+
     std::size_t written = 0;
+    auto bulk = write_process_memory(pid_, address, data.begin(), data.size());
+    if (bulk > 0) written += bulk;
+    if (written == data.size()) return;
+
+    // process_vm_writev honours page protections, /proc/pid/mem does not for a tracer
+    while (written < data.size())
+    {
+        auto n = pwrite(memory_file(), data.begin() + written, data.size() - written, (address + written).addr());
+        if (n <= 0) break;
+        written += n;
+    }
+
     while (written < data.size())
     {
         auto remaining = data.size() - written;
@@ -591,7 +1314,7 @@ void sdb::process::write_memory(virt_addr address, span<const std::byte> data)
             std::memcpy(word_data + remaining, read.data() + remaining, 8 - remaining);
         }
 
-        if (ptrace(PTRACE_POKEDATA, pid_, address + written, word) < 0)
+        if (ptrace(PTRACE_POKEDATA, memory_access_tid(), address + written, word) < 0)
         {
             error::send_errno("Failed to write memory");
         }
@@ -600,6 +1323,17 @@ void sdb::process::write_memory(virt_addr address, span<const std::byte> data)
     }
 }
 
+int sdb::process::memory_file()
+{
+    if (memory_fd_ < 0)
+    {
+        auto path = "/proc/" + std::to_string(pid_) + "/mem";
+        memory_fd_ = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    }
+
+    return memory_fd_;
+}
+
 int sdb::process::set_watchpoint(watchpoint::id_type id, virt_addr address, stoppoint_mode mode, std::size_t size)
 {
     return set_hardware_stoppoint(address, mode, size);
@@ -631,22 +1365,42 @@ bool sdb::process::should_resume_from_syscall(const stop_reason& reason)
     return false;
 }
 
-std::string sdb::process::read_string(virt_addr address) const
+std::string sdb::process::read_string(virt_addr address, std::size_t max_length) const
 {
     std::string ret;
-    while (true)
+    while (ret.size() < max_length)
     {
-        auto data = read_memory(address, 1024);
-        for (auto c: data)
+        // Reads never straddle a page, so an unmapped page only loses what lies inside it
+        auto up_to_next_page = page_size - (address.addr() & (page_size - 1));
+        auto chunk_size = std::min(max_length - ret.size(), up_to_next_page);
+
+        std::vector<std::byte> data;
+        try
         {
-            if (c == std::byte{0}) return ret;
-            ret.push_back(static_cast<char>(c));
+            data = read_memory(address, chunk_size);
+
+        } catch (const error&) {
+
+            if (ret.empty()) throw;
+            return ret;
         }
+
+        auto chars = reinterpret_cast<const char*>(data.data());
+        if (auto terminator = static_cast<const char*>(std::memchr(chars, 0, chunk_size)))
+        {
+            ret.append(chars, terminator);
+            return ret;
+        }
+        ret.append(chars, chunk_size);
+        address += chunk_size;
     }
+    return ret;
 }
 
 void sdb::process::augment_stop_reason(sdb::stop_reason& reason)
 {
+    if (reason.trap_reason == trap_type::interrupt) return;
+
     siginfo_t info;
     auto tid = reason.tid;
     if (ptrace(PTRACE_GETSIGINFO, tid, nullptr, &info) < 0)
@@ -685,7 +1439,16 @@ void sdb::process::augment_stop_reason(sdb::stop_reason& reason)
         return;
     }
 
-    expecting_syscall_exit_ = false;
+    expecting_syscall_exit_ = (info.si_code == (SIGTRAP | (PTRACE_EVENT_EXEC << 8)));
+    if (expecting_syscall_exit_)
+    {
+        displaced_step_area_.reset();
+        displaced_step_area_failed_ = false;
+
+        // A /proc/pid/mem descriptor stays bound to the address space it was opened on
+        if (memory_fd_ >= 0) close(memory_fd_);
+        memory_fd_ = -1;
+    }
 
     reason.trap_reason = trap_type::unknown;
     if (reason.info == SIGTRAP)
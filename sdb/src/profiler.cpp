@@ -0,0 +1,134 @@
+#include <libsdb/profiler.hpp>
+#include <libsdb/target.hpp>
+#include <libsdb/error.hpp>
+#include <libsdb/event_loop.hpp>
+
+sdb::profiler::profiler(target& tgt, std::size_t ring_capacity): target_(&tgt), ring_(ring_capacity), nodes_(1)
+{
+    if (ring_capacity == 0) error::send("Profiler ring buffer must not be empty");
+}
+
+bool sdb::profiler::sample()
+{
+    auto& proc = target_->get_process();
+    if (ring_size_ + target_->threads().size() > ring_.size()) flush();
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (proc.state() == process_state::running)
+    {
+        proc.interrupt();
+        auto reason = proc.wait_on_signal();
+        if (reason.reason != process_state::stopped) return false;
+    }
+
+    for (auto& [tid, thread]: target_->threads())
+    {
+        if ((thread.state->state != process_state::stopped) or (ring_size_ == ring_.size())) continue;
+
+        auto& frames = ring_[(ring_head_ + ring_size_) % ring_.size()];
+        frames.clear();
+        for (auto& frame: thread.frames.frames())
+        {
+            frames.push_back({&frame_name(frame.backtrace_report_address, frame.func_die, frame.inlined)});
+        }
+        if (frames.empty()) frames.push_back({&frame_name(proc.get_pc(tid), die{nullptr}, false)});
+
+        ++ring_size_;
+        ++stats_.n_samples;
+    }
+
+    proc.resume_all_threads();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    ++stats_.n_ticks;
+    stats_.total_stop_time += elapsed;
+    stats_.max_stop_time = std::max(stats_.max_stop_time, elapsed);
+
+    return true;
+}
+
+void sdb::profiler::run(std::chrono::nanoseconds interval, std::chrono::nanoseconds duration)
+{
+    auto& proc = target_->get_process();
+    if (proc.state() == process_state::stopped) proc.resume_all_threads();
+
+    event_loop loop;
+    loop.watch(proc, [&](const stop_reason& reason) {
+        if ((reason.reason != process_state::stopped) or !sample()) loop.stop();
+    });
+    loop.add_timer(interval, [&] {
+        if (!sample()) loop.stop();
+    });
+    loop.add_timer(duration, [&] { loop.stop(); });
+    loop.run();
+
+    flush();
+}
+
+void sdb::profiler::flush()
+{
+    for (; ring_size_ > 0; --ring_size_, ring_head_ = (ring_head_ + 1) % ring_.size())
+    {
+        auto& frames = ring_[ring_head_];
+
+        std::size_t node = 0;
+        for (auto it = frames.rbegin(); it != frames.rend(); ++it) node = child(node, *it->name);
+        ++nodes_[node].count;
+    }
+}
+
+std::size_t sdb::profiler::child(std::size_t parent, const std::string& name)
+{
+    auto found = nodes_[parent].children.find(name);
+    if (found != nodes_[parent].children.end()) return found->second;
+
+    auto index = nodes_.size();
+    nodes_[parent].children.emplace(name, index);
+    nodes_.push_back(call_tree_node{name, 0, {}});
+    return index;
+}
+
+const std::string& sdb::profiler::frame_name(virt_addr pc, const die& func, bool inlined)
+{
+    if (inlined and func.name())
+    {
+        auto name = *func.name();
+        auto found = inlined_names_.find(name);
+        if (found == inlined_names_.end()) found = inlined_names_.emplace(name, std::string(name) + " [inlined]").first;
+        return found->second;
+    }
+
+    auto found = symbol_names_.find(pc.addr());
+    if (found != symbol_names_.end()) return found->second;
+
+    auto name = target_->function_name_at_address(pc);
+    if (name.empty()) name = "??";
+
+    return symbol_names_.emplace(pc.addr(), std::move(name)).first->second;
+}
+
+std::string sdb::profiler::folded_stacks()
+{
+    flush();
+
+    std::string prefix;
+    std::string out;
+    write_folded(0, prefix, out);
+    return out;
+}
+
+void sdb::profiler::write_folded(std::size_t node, std::string& prefix, std::string& out) const
+{
+    auto& current = nodes_[node];
+    if ((node != 0) and (current.count > 0)) out += prefix + ' ' + std::to_string(current.count) + '\n';
+
+    for (auto& [name, index]: current.children)
+    {
+        auto old_size = prefix.size();
+        if (!prefix.empty()) prefix += ';';
+        prefix += name;
+        write_folded(index, prefix, out);
+        prefix.resize(old_size);
+    }
+}
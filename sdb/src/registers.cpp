@@ -108,6 +108,8 @@ void sdb::registers::write(const register_info& info, value val, bool commit)
 
 void sdb::registers::undefine(register_id id)
 {
+    if (is_undefined(id)) return;
+
     std::size_t canonical_offset = register_info_by_id(id).offset >> 1;
     undefined_.push_back(canonical_offset);
 }
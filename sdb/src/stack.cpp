@@ -1,5 +1,8 @@
 #include <libsdb/stack.hpp>
 #include <libsdb/target.hpp>
+#include <libsdb/error.hpp>
+#include <libsdb/bit.hpp>
+#include <limits>
 
 std::vector<sdb::die> sdb::stack::inline_stack_at_pc() const
 {
@@ -21,12 +24,31 @@ void sdb::stack::reset_inline_height()
 
 sdb::span<const sdb::stack_frame> sdb::stack::frames() const
 {
+    unwind_frames(std::numeric_limits<std::size_t>::max());
     return { frames_.data() + inline_height_, frames_.size() - inline_height_ };
 }
 
+const sdb::stack_frame& sdb::stack::frame(std::size_t index) const
+{
+    unwind_frames(inline_height_ + index + 1);
+    return frames_[inline_height_ + index];
+}
+
+const sdb::stack_frame& sdb::stack::current_frame() const
+{
+    unwind_frames(current_frame_ + 1);
+    return frames_[current_frame_];
+}
+
+bool sdb::stack::has_frames() const
+{
+    unwind_frames(1);
+    return !frames_.empty();
+}
+
 const sdb::registers& sdb::stack::regs() const
 {
-    return frames_[current_frame_].regs;
+    return current_frame().regs;
 }
 
 sdb::virt_addr sdb::stack::get_pc() const
@@ -34,44 +56,77 @@ sdb::virt_addr sdb::stack::get_pc() const
     return virt_addr{regs().read_by_id_as<std::uint64_t>(sdb::register_id::rip)};
 }
 
-void sdb::stack::unwind()
+void sdb::stack::invalidate()
 {
     reset_inline_height();
     current_frame_ = inline_height_;
-    auto virt_pc = target_->get_process().get_pc(tid_);
-    auto file_pc = target_->get_pc_file_address(tid_);
-    auto& proc = target_->get_process();
-    auto regs = proc.get_registers(tid_);
-
     frames_.clear();
+    complete_ = false;
+}
 
-    auto elf = file_pc.elf_file();
-    if (!elf) return;
+void sdb::stack::unwind()
+{
+    invalidate();
+    unwind_frames(std::numeric_limits<std::size_t>::max());
+}
 
-    while ((virt_pc.addr() != 0) and elf)
+void sdb::stack::unwind_frames(std::size_t count) const
+{
+    if (complete_ or (frames_.size() >= count)) return;
+
+    auto& proc = target_->get_process();
+    if (frames_.empty())
     {
-        auto& dwarf = elf->get_dwarf();
-        auto inline_stack = dwarf.inline_stack_at_address(file_pc);
-        if (inline_stack.empty()) return;
+        proc.snapshot_stack(tid_);
+        next_regs_ = proc.get_registers(tid_);
+        next_pc_ = target_->get_pc_file_address(tid_);
+    }
 
+    auto follow_frame_pointers = (target_->get_unwind_mode() == unwind_mode::frame_pointer);
+
+    while (!complete_ and (frames_.size() < count))
+    {
+        auto elf = next_pc_.elf_file();
+        auto inline_stack = elf ? elf->get_dwarf().inline_stack_at_address(next_pc_) : std::vector<die>{};
+        if (inline_stack.empty())
+        {
+            complete_ = true;
+            return;
+        }
+
+        auto innermost = frames_.empty();
+        auto first_new_frame = frames_.size();
         if (inline_stack.size() > 1)
         {
-            create_base_frame(regs, inline_stack, file_pc, true);
-            create_inline_stack_frames(regs, inline_stack, file_pc);
+            create_base_frame(next_regs_, inline_stack, next_pc_, true);
+            create_inline_stack_frames(next_regs_, inline_stack, next_pc_);
 
         } else {
 
-            create_base_frame(regs, inline_stack, file_pc, false);
+            create_base_frame(next_regs_, inline_stack, next_pc_, false);
         }
 
-        regs = dwarf.cfi().unwind(proc, file_pc, frames_.back().regs);
-        virt_pc = virt_addr{regs.read_by_id_as<std::uint64_t>(register_id::rip) - 1};
-        file_pc = virt_pc.to_file_addr(target_->get_elves());
-        elf = file_pc.elf_file();
+        try
+        {
+            if (!follow_frame_pointers or innermost or !unwind_frame_pointer(frames_.back().regs, next_regs_))
+            {
+                next_regs_ = elf->get_dwarf().cfi().unwind(proc, next_pc_, frames_.back().regs);
+            }
+
+        } catch (...) {
+
+            // Drop the frames of this pc so that the next attempt starts from it again
+            frames_.erase(frames_.begin() + first_new_frame, frames_.end());
+            throw;
+        }
+
+        auto virt_pc = virt_addr{next_regs_.read_by_id_as<std::uint64_t>(register_id::rip) - 1};
+        complete_ = (virt_pc.addr() == 0);
+        if (!complete_) next_pc_ = virt_pc.to_file_addr(target_->get_elves());
     }
 }
 
-void sdb::stack::create_inline_stack_frames(const registers& regs, const std::vector<sdb::die> inline_stack, file_addr pc)
+void sdb::stack::create_inline_stack_frames(const registers& regs, const std::vector<sdb::die> inline_stack, file_addr pc) const
 {
     for (auto it = inline_stack.rbegin() + 1; it != inline_stack.rend(); ++it)
     {
@@ -82,7 +137,7 @@ void sdb::stack::create_inline_stack_frames(const registers& regs, const std::ve
     }
 }
 
-void sdb::stack::create_base_frame(const registers& regs, const std::vector<sdb::die> inline_stack, file_addr pc, bool inlined)
+void sdb::stack::create_base_frame(const registers& regs, const std::vector<sdb::die> inline_stack, file_addr pc, bool inlined) const
 {
     auto backtrace_pc = pc.to_virt_addr();
     auto line_entry = pc.elf_file()->get_dwarf().line_entry_at_address(pc);
@@ -90,4 +145,39 @@ void sdb::stack::create_base_frame(const registers& regs, const std::vector<sdb:
 
     frames_.push_back({regs, backtrace_pc, inline_stack.back(), inlined});
     frames_.back().location = source_location{line_entry->file_entry, line_entry->line};
+}
+
+bool sdb::stack::unwind_frame_pointer(registers& frame_regs, registers& unwound) const
+{
+    if (frame_regs.is_undefined(register_id::rbp)) return false;
+
+    auto rsp = frame_regs.read_by_id_as<std::uint64_t>(register_id::rsp);
+    auto rbp = frame_regs.read_by_id_as<std::uint64_t>(register_id::rbp);
+    if ((rbp < rsp) or (rbp % 8 != 0)) return false;
+
+    std::uint64_t saved_rbp;
+    std::uint64_t return_address;
+    try
+    {
+        auto frame_record = target_->get_process().read_memory(virt_addr{rbp}, 16);
+        saved_rbp = from_bytes<std::uint64_t>(frame_record.data());
+        return_address = from_bytes<std::uint64_t>(frame_record.data() + 8);
+
+    } catch (const sdb::error&) {
+
+        return false;
+    }
+
+    if ((saved_rbp != 0) and (saved_rbp <= rbp)) return false;
+    if (!virt_addr{return_address - 1}.to_file_addr(target_->get_elves()).elf_file()) return false;
+
+    frame_regs.set_cfa(virt_addr{rbp + 16});
+
+    unwound = frame_regs;
+    unwound.write_by_id(register_id::rip, return_address, false);
+    unwound.write_by_id(register_id::rsp, rbp + 16, false);
+    unwound.write_by_id(register_id::rbp, saved_rbp, false);
+    for (auto id: {register_id::rbx, register_id::r12, register_id::r13, register_id::r14, register_id::r15}) unwound.undefine(id);
+
+    return true;
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <libsdb/type.hpp>
 #include <libsdb/parse.hpp>
 #include <csignal>
+#include <climits>
 #include <optional>
 #include <fstream>
 #include <cxxabi.h>
@@ -407,7 +408,7 @@ sdb::file_addr sdb::target::get_pc_file_address(std::optional<pid_t> otid) const
 
 void sdb::target::notify_stop(const sdb::stop_reason& reason)
 {
-    threads_.at(reason.tid).frames.unwind();
+    threads_.at(reason.tid).frames.invalidate();
 }
 
 void sdb::target::notify_thread_lifecycle_event(const sdb::stop_reason& reason)
@@ -515,15 +516,16 @@ sdb::stop_reason sdb::target::step_out(std::optional<pid_t> otid)
         return run_until_address(return_address, tid);
     }
 
-    auto& regs = stack.frames()[stack.current_frame_index() + 1].regs;
+    auto& regs = stack.frame(stack.current_frame_index() + 1).regs;
     virt_addr return_address{regs.read_by_id_as<std::uint64_t>(register_id::rip)};
+    auto return_frame_rsp = regs.read_by_id_as<std::uint64_t>(register_id::rsp);
 
     sdb::stop_reason reason;
-    for (auto frames = stack.frames().size(); stack.frames().size() >= frames;)
+    do
     {
         reason = run_until_address(return_address, tid);
         if (reason.is_breakpoint() || (process_->get_pc() != return_address)) return reason;
-    }
+    } while (process_->get_registers(tid).read_by_id_as<std::uint64_t>(register_id::rsp) < return_frame_rsp);
 
     return reason;
 }
@@ -672,11 +674,8 @@ std::vector<sdb::line_table::iterator> sdb::target::get_line_entries_by_line(std
     std::vector<sdb::line_table::iterator> entries;
     elves_.for_each([&](auto& elf)
     {
-        for (auto& cu: elf.get_dwarf().compile_units())
-        {
-            auto new_entries = cu->lines().get_entries_by_line(path, line);
-            entries.insert(entries.end(), new_entries.begin(), new_entries.end());
-        }
+        auto new_entries = elf.get_dwarf().get_line_entries_by_line(path, line);
+        entries.insert(entries.end(), new_entries.begin(), new_entries.end());
     });
 
     return entries;
@@ -693,16 +692,28 @@ void sdb::target::reload_dynamic_libraries()
     auto debug = read_dynamic_linker_rendezvous();
     if (!debug) return;
 
+    std::vector<link_map> entries;
     auto entry_ptr = debug->r_map;
     while (entry_ptr != nullptr)
     {
         auto entry_addr = virt_addr(reinterpret_cast<std::uint64_t>(entry_ptr));
-        auto entry = process_->read_memory_as<link_map>(entry_addr);
-        entry_ptr = entry.l_next;
+        entries.push_back(process_->read_memory_as<link_map>(entry_addr));
+        entry_ptr = entries.back().l_next;
+    }
 
-        auto name_addr = virt_addr(reinterpret_cast<std::uint64_t>(entry.l_name));
-        auto name_bytes = process_->read_memory(name_addr, 4096);
-        auto name = std::filesystem::path{reinterpret_cast<char*>(name_bytes.data())};
+    // Fetch every name in one go; a name near the end of a mapping just comes back shorter
+    std::vector<process::memory_read_request> name_requests;
+    for (auto& entry: entries)
+    {
+        name_requests.push_back({virt_addr(reinterpret_cast<std::uint64_t>(entry.l_name)), PATH_MAX});
+    }
+    auto names = process_->read_memory_batch(name_requests);
+
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+        auto& entry = entries[i];
+        auto name_chars = std::string(reinterpret_cast<const char*>(names[i].data.data()), names[i].data.size());
+        auto name = std::filesystem::path{name_chars.substr(0, name_chars.find('\0'))};
         if (name.empty()) continue;
 
         const elf* found = nullptr;
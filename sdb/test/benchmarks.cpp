@@ -0,0 +1,226 @@
+#include <libsdb/elf.hpp>
+#include <libsdb/dwarf.hpp>
+#include <libsdb/error.hpp>
+#include <libsdb/target.hpp>
+#include <libsdb/bit.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <sys/ptrace.h>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+
+using namespace sdb;
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    double seconds_since(clock::time_point start)
+    {
+        return std::chrono::duration<double>(clock::now() - start).count();
+    }
+
+    std::size_t count_dies(const die& d)
+    {
+        std::size_t count = 1;
+        for (auto& child: d.children()) count += count_dies(child);
+        return count;
+    }
+
+    void benchmark_dwarf_index(const std::filesystem::path& path)
+    {
+        elf obj(path);
+        auto& dwarf = obj.get_dwarf();
+
+        std::size_t n_dies = 0;
+        for (auto& cu: dwarf.compile_units()) n_dies += count_dies(cu->root());
+
+        auto start = clock::now();
+        dwarf.find_functions("main");
+        auto elapsed = seconds_since(start);
+
+        auto n_cus = dwarf.compile_units().size();
+        std::cout << "dwarf_index: " << path.string() << '\n'
+                  << "  threads:  " << std::thread::hardware_concurrency() << '\n'
+                  << "  CUs:      " << n_cus << '\n'
+                  << "  DIEs:     " << n_dies << '\n'
+                  << "  time:     " << elapsed * 1000 << " ms\n"
+                  << "  CUs/s:    " << n_cus / elapsed << '\n'
+                  << "  DIEs/s:   " << n_dies / elapsed << '\n';
+    }
+
+    void benchmark_dwarf_traversal(const std::filesystem::path& path)
+    {
+        elf obj(path);
+        auto& dwarf = obj.get_dwarf();
+        auto debug_info_size = obj.get_section_contents(".debug_info").size();
+
+        constexpr int n_passes = 10;
+        std::size_t n_dies = 0;
+        auto start = clock::now();
+        for (int i = 0; i < n_passes; ++i)
+        {
+            for (auto& cu: dwarf.compile_units()) n_dies += count_dies(cu->root());
+        }
+        auto elapsed = seconds_since(start);
+
+        std::cout << "dwarf_traversal: " << path.string() << '\n'
+                  << "  .debug_info: " << debug_info_size << " bytes\n"
+                  << "  DIEs/pass:   " << n_dies / n_passes << '\n'
+                  << "  time/pass:   " << elapsed * 1000 / n_passes << " ms\n"
+                  << "  MB/s:        " << debug_info_size * n_passes / elapsed / 1e6 << '\n';
+    }
+
+    void benchmark_dwarf_lookup(const std::filesystem::path& path)
+    {
+        auto start = clock::now();
+        elf obj(path);
+        auto found = obj.get_dwarf().find_functions("main");
+        auto elapsed = seconds_since(start);
+
+        std::cout << "dwarf_lookup: " << path.string() << '\n'
+                  << "  accelerated: " << (obj.get_section(".debug_names") or obj.get_section(".gdb_index") ? "yes" : "no") << '\n'
+                  << "  found:       " << found.size() << '\n'
+                  << "  time:        " << elapsed * 1000 << " ms\n";
+    }
+
+    void benchmark_line_lookup(const std::filesystem::path& path)
+    {
+        elf obj(path);
+        auto& dwarf = obj.get_dwarf();
+
+        constexpr int n_lookups = 200;
+        std::size_t n_entries = 0;
+        auto start = clock::now();
+        for (int i = 0; i < n_lookups; ++i)
+        {
+            auto file = "large_dwarf_cu_" + std::to_string(i % 64) + ".cpp";
+            n_entries += dwarf.get_line_entries_by_line(file, 20 + i % 10).size();
+        }
+        auto elapsed = seconds_since(start);
+
+        std::cout << "line_lookup: " << path.string() << '\n'
+                  << "  lookups: " << n_lookups << '\n'
+                  << "  entries: " << n_entries << '\n'
+                  << "  time:    " << elapsed * 1000 << " ms\n";
+    }
+
+    void benchmark_unwind(const std::filesystem::path& path)
+    {
+        auto dev_null = open("/dev/null", O_WRONLY);
+        auto target = target::launch(path, dev_null);
+        auto& proc = target->get_process();
+        target->create_function_breakpoint("bottom").enable();
+        proc.resume();
+        proc.wait_on_signal();
+
+        std::cout << "unwind: " << path.string() << '\n';
+        for (auto [name, mode]: {std::pair{"precise", unwind_mode::precise}, std::pair{"frame_pointer", unwind_mode::frame_pointer}})
+        {
+            target->set_unwind_mode(mode);
+
+            constexpr int n_passes = 20;
+            std::size_t n_frames = 0;
+            auto start = clock::now();
+            for (int i = 0; i < n_passes; ++i)
+            {
+                target->get_stack().unwind();
+                n_frames += target->get_stack().frames().size();
+            }
+            auto elapsed = seconds_since(start);
+
+            std::cout << "  " << name << ":\n"
+                      << "    frames:    " << n_frames / n_passes << '\n'
+                      << "    time/pass: " << elapsed * 1000 / n_passes << " ms\n"
+                      << "    frames/s:  " << n_frames / elapsed << '\n';
+        }
+
+        close(dev_null);
+    }
+
+    void benchmark_write_memory(const std::filesystem::path& path)
+    {
+        auto dev_null = open("/dev/null", O_WRONLY);
+        auto target = target::launch(path, dev_null);
+        auto& proc = target->get_process();
+        target->create_function_breakpoint("main").enable();
+        proc.resume();
+        proc.wait_on_signal();
+
+        auto& elf = target->get_main_elf();
+        auto buffer = file_addr{elf, elf.get_symbols_by_name("g_buffer").at(0)->st_value}.to_virt_addr();
+
+        constexpr std::size_t max_size = 16 * 1024 * 1024;
+        std::vector<std::byte> data(max_size, std::byte{0x5a});
+
+        std::cout << "write_memory: " << path.string() << '\n';
+        for (std::size_t size = 4096; size <= max_size; size *= 4)
+        {
+            auto n_passes = std::max<std::size_t>(1, max_size / size);
+            auto start = clock::now();
+            for (std::size_t i = 0; i < n_passes; ++i) proc.write_memory(buffer, {data.data(), size});
+            auto bulk = seconds_since(start);
+
+            // One PTRACE_POKEDATA per word, as write_memory used to do
+            start = clock::now();
+            for (std::size_t offset = 0; offset < size; offset += 8)
+            {
+                ptrace(PTRACE_POKEDATA, proc.pid(), (buffer + offset).addr(), from_bytes<std::uint64_t>(data.data() + offset));
+            }
+            auto poke = seconds_since(start);
+
+            std::cout << "  " << size / 1024 << " KiB:\n"
+                      << "    bulk MB/s:     " << size * n_passes / bulk / 1e6 << '\n'
+                      << "    pokedata MB/s: " << size / poke / 1e6 << '\n';
+        }
+
+        close(dev_null);
+    }
+
+    struct benchmark
+    {
+        std::function<void(const std::filesystem::path&)> run;
+        std::filesystem::path default_target;
+    };
+
+    const std::map<std::string, benchmark> benchmarks = {
+        {"dwarf_index", {benchmark_dwarf_index, "targets/large_dwarf"}},
+#ifdef SDB_HAVE_GOLD
+        {"dwarf_lookup", {benchmark_dwarf_lookup, "targets/large_dwarf_gdb_index"}},
+#else
+        {"dwarf_lookup", {benchmark_dwarf_lookup, "targets/large_dwarf"}},
+#endif
+        {"dwarf_traversal", {benchmark_dwarf_traversal, "targets/large_dwarf"}},
+        {"line_lookup", {benchmark_line_lookup, "targets/large_dwarf"}},
+        {"unwind", {benchmark_unwind, "targets/deep_recursion"}},
+        {"write_memory", {benchmark_write_memory, "targets/large_buffer"}},
+    };
+}
+
+int main(int argc, const char** argv)
+{
+    if ((argc > 1) and (!benchmarks.count(argv[1])))
+    {
+        std::cerr << "Unknown benchmark " << argv[1] << "\nAvailable benchmarks:\n";
+        for (auto& [name, _]: benchmarks) std::cerr << "    " << name << '\n';
+        return -1;
+    }
+
+    try
+    {
+        for (auto& [name, bench]: benchmarks)
+        {
+            if ((argc > 1) and (name != argv[1])) continue;
+            bench.run((argc > 2) ? std::filesystem::path(argv[2]) : bench.default_target);
+        }
+
+    } catch (const sdb::error& err) {
+
+        std::cerr << err.what() << '\n';
+        return -1;
+    }
+}
@@ -0,0 +1,22 @@
+#include <cstdio>
+
+void bottom()
+{
+    std::puts("Reached the bottom");
+}
+
+int recurse(int depth)
+{
+    if (depth == 0)
+    {
+        bottom();
+        return 0;
+    }
+
+    return recurse(depth - 1) + 1;
+}
+
+int main()
+{
+    return (recurse(500) == 500) ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+#include <cstdio>
+
+char g_buffer[16 * 1024 * 1024];
+
+int main()
+{
+    std::puts(g_buffer);
+}
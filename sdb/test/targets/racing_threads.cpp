@@ -0,0 +1,24 @@
+#include <pthread.h>
+#include <vector>
+
+pthread_barrier_t barrier;
+
+void race()
+{
+}
+
+void* run_race(void*)
+{
+    pthread_barrier_wait(&barrier);
+    race();
+    return nullptr;
+}
+
+int main()
+{
+    std::vector<pthread_t> threads(10);
+    pthread_barrier_init(&barrier, nullptr, threads.size());
+
+    for (auto& thread: threads) pthread_create(&thread, nullptr, run_race, nullptr);
+    for (auto& thread: threads) pthread_join(thread, nullptr);
+}
@@ -0,0 +1,33 @@
+#include <pthread.h>
+#include <atomic>
+
+std::atomic<std::atomic<unsigned long>*> g_counter{nullptr};
+std::atomic<bool> g_done{false};
+
+void checkpoint()
+{
+}
+
+void* write_counter(void*)
+{
+    while (!g_done)
+    {
+        if (auto counter = g_counter.load()) counter->fetch_add(1);
+    }
+    return nullptr;
+}
+
+int main()
+{
+    std::atomic<unsigned long> counter{0};
+
+    pthread_t writer;
+    pthread_create(&writer, nullptr, write_counter, nullptr);
+
+    g_counter = &counter;
+    while (counter < 1000) {}
+
+    checkpoint();
+    g_done = true;
+    pthread_join(writer, nullptr);
+}
@@ -7,13 +7,22 @@
 #include <libsdb/target.hpp>
 #include <libsdb/dwarf.hpp>
 #include <libsdb/type.hpp>
+#include <libsdb/index_cache.hpp>
+#include <libsdb/profiler.hpp>
+#include <libsdb/event_loop.hpp>
 #include <elf.h>
 #include <sys/types.h>
+#include <sys/ptrace.h>
 #include <signal.h>
 #include <fcntl.h>
 #include <fstream>
 #include <regex>
 #include <set>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <tuple>
 #include <iostream>
 
 using namespace sdb;
@@ -97,6 +106,28 @@ namespace
         }
         sdb::error::send("Could not find load address");
     }
+
+    virt_addr get_writable_mapping_end(pid_t pid)
+    {
+        std::ifstream maps("/proc/" + std::to_string(pid) + "/maps");
+        std::regex map_regex(R"((\w+)-(\w+) .(.))");
+
+        std::vector<std::tuple<std::uint64_t, std::uint64_t, bool>> mappings;
+        std::string data;
+        while (std::getline(maps, data))
+        {
+            std::smatch groups;
+            std::regex_search(data, groups, map_regex);
+            mappings.emplace_back(std::stoull(groups[1], nullptr, 16), std::stoull(groups[2], nullptr, 16), groups[3] == 'w');
+        }
+
+        for (std::size_t i = 0; i + 1 < mappings.size(); ++i)
+        {
+            auto [low, high, writable] = mappings[i];
+            if (writable and (std::get<0>(mappings[i + 1]) != high)) return virt_addr{high};
+        }
+        sdb::error::send("Could not find writable mapping");
+    }
 }
 
 TEST_CASE("process::launch success", "[process]")
@@ -117,6 +148,44 @@ TEST_CASE("process::attach success", "[process]")
     REQUIRE(get_process_status(target->pid()) == 't');
 }
 
+TEST_CASE("process::interrupt stops a running process", "[process]")
+{
+    auto target = process::launch("targets/run_endlessly", false);
+    auto proc = process::attach(target->pid());
+    proc->resume();
+    proc->interrupt();
+    auto reason = proc->wait_on_signal();
+
+    REQUIRE(reason.reason == sdb::process_state::stopped);
+    REQUIRE(reason.trap_reason == sdb::trap_type::interrupt);
+    REQUIRE(get_process_status(target->pid()) == 't');
+
+    proc->resume();
+    auto status = get_process_status(proc->pid());
+    REQUIRE(((status == 'R') or (status == 'S')));
+}
+
+TEST_CASE("Group-stops are reported as signal stops", "[process]")
+{
+    auto proc = process::launch("targets/run_endlessly");
+    proc->resume();
+    kill(proc->pid(), SIGSTOP);
+    auto reason = proc->wait_on_signal();
+    REQUIRE(reason.info == SIGSTOP);
+
+    // Delivering the signal puts the process into a group-stop
+    REQUIRE(ptrace(PTRACE_CONT, proc->pid(), nullptr, SIGSTOP) == 0);
+    reason = proc->wait_on_signal();
+
+    REQUIRE(reason.reason == sdb::process_state::stopped);
+    REQUIRE(reason.info == SIGSTOP);
+    REQUIRE(reason.trap_reason != sdb::trap_type::interrupt);
+
+    proc->resume();
+    auto status = get_process_status(proc->pid());
+    REQUIRE(((status == 'R') or (status == 'S')));
+}
+
 TEST_CASE("process::attach invalid PID", "[process]")
 {
     REQUIRE_THROWS_AS(process::attach(0), sdb::error);
@@ -370,6 +439,55 @@ TEST_CASE("Can remove breakpoint sites", "[breakpoint]")
     REQUIRE(proc->breakpoint_sites().empty());
 }
 
+TEST_CASE("Breakpoint site lookups stay consistent across many sites", "[breakpoint]")
+{
+    auto proc = process::launch("targets/run_endlessly");
+    auto& sites = proc->breakpoint_sites();
+
+    constexpr std::uint64_t n_sites = 20000;
+    std::vector<breakpoint_site::id_type> ids;
+    for (std::uint64_t i = 0; i < n_sites; ++i)
+    {
+        // Created out of address order so the region lookup has to restore creation order
+        auto addr = 0x1000 + ((i * 7919) % n_sites) * 2;
+        ids.push_back(proc->create_breakpoint_site(virt_addr{addr}).id());
+    }
+    REQUIRE(sites.size() == n_sites);
+
+    for (std::uint64_t i = 0; i < n_sites; i += 997)
+    {
+        auto addr = virt_addr{0x1000 + ((i * 7919) % n_sites) * 2};
+        REQUIRE(sites.get_by_id(ids[i]).address() == addr);
+        REQUIRE(sites.get_by_address(addr).id() == ids[i]);
+        REQUIRE(!sites.contains_address(addr + 1));
+    }
+
+    auto region = sites.get_in_region(virt_addr{0x1000 + 100}, virt_addr{0x1000 + 120});
+    REQUIRE(region.size() == 10);
+    std::set<std::uint64_t> region_addresses;
+    for (std::size_t i = 0; i < region.size(); ++i)
+    {
+        region_addresses.insert(region[i]->address().addr());
+        if (i > 0) REQUIRE(region[i - 1]->id() < region[i]->id());
+    }
+    REQUIRE(region_addresses.size() == 10);
+    REQUIRE(*region_addresses.begin() == 0x1000 + 100);
+    REQUIRE(*region_addresses.rbegin() == 0x1000 + 118);
+    REQUIRE(sites.get_in_region(virt_addr{0x1000 + 120}, virt_addr{0x1000 + 100}).empty());
+
+    sites.remove_by_address(virt_addr{0x1000 + 104});
+    sites.remove_by_id(ids[1]);
+    REQUIRE(sites.size() == n_sites - 2);
+    REQUIRE(!sites.contains_address(virt_addr{0x1000 + 104}));
+    REQUIRE(!sites.contains_id(ids[1]));
+    REQUIRE_THROWS_AS(sites.get_by_id(ids[1]), error);
+    REQUIRE(sites.get_in_region(virt_addr{0x1000 + 100}, virt_addr{0x1000 + 120}).size() == 9);
+
+    proc->create_breakpoint_site(virt_addr{0x1000 + 104});
+    REQUIRE(sites.contains_address(virt_addr{0x1000 + 104}));
+    REQUIRE(sites.get_in_region(virt_addr{0x1000 + 100}, virt_addr{0x1000 + 120}).size() == 10);
+}
+
 TEST_CASE("Reading and writing memory works", "[memory]")
 {
     bool close_on_exec = false;
@@ -398,6 +516,168 @@ TEST_CASE("Reading and writing memory works", "[memory]")
     REQUIRE(to_string_view(read) == "Hello, sdb!");
 }
 
+TEST_CASE("Writing large blocks of memory works", "[memory]")
+{
+    auto dev_null = open("/dev/null", O_WRONLY);
+    auto target = target::launch("targets/large_buffer", dev_null);
+    auto& proc = target->get_process();
+    target->create_function_breakpoint("main").enable();
+    proc.resume();
+    proc.wait_on_signal();
+
+    auto& elf = target->get_main_elf();
+    auto symbol = elf.get_symbols_by_name("g_buffer").at(0);
+    auto buffer = file_addr{elf, symbol->st_value}.to_virt_addr();
+
+    // Spans more pages than IOV_MAX and more than 4 MiB, so the writes are split into batches
+    REQUIRE(symbol->st_size > 4 * 1024 * 1024);
+    std::vector<std::byte> data(symbol->st_size - 10);
+    for (std::size_t i = 0; i < data.size(); ++i) data[i] = std::byte(i * 7 + 1);
+
+    proc.write_memory(buffer + 5, {data.data(), data.size()});
+
+    auto read = proc.read_memory(buffer, symbol->st_size);
+    REQUIRE(std::all_of(read.begin(), read.begin() + 5, [](auto b) { return b == std::byte{0}; }));
+    REQUIRE(std::equal(data.begin(), data.end(), read.begin() + 5));
+    REQUIRE(std::all_of(read.end() - 5, read.end(), [](auto b) { return b == std::byte{0}; }));
+    close(dev_null);
+}
+
+TEST_CASE("Reading strings stops at the terminator, limit or unmapped page", "[memory]")
+{
+    auto dev_null = open("/dev/null", O_WRONLY);
+    auto target = target::launch("targets/large_buffer", dev_null);
+    auto& proc = target->get_process();
+    target->create_function_breakpoint("main").enable();
+    proc.resume();
+    proc.wait_on_signal();
+
+    auto& elf = target->get_main_elf();
+    auto buffer = file_addr{elf, elf.get_symbols_by_name("g_buffer").at(0)->st_value}.to_virt_addr();
+
+    std::string long_string(3 * 0x1000 + 17, 'x');
+    proc.write_memory(buffer + 0xff0, {reinterpret_cast<const std::byte*>(long_string.c_str()), long_string.size() + 1});
+    REQUIRE(proc.read_string(buffer + 0xff0) == long_string);
+    REQUIRE(proc.read_string(buffer + 0xff0, 20) == std::string(20, 'x'));
+    REQUIRE(proc.read_string(buffer + 0xff0, 0).empty());
+
+    auto mapping_end = get_writable_mapping_end(proc.pid());
+    proc.write_memory(mapping_end - 3, {as_bytes("sdb"), 3});
+    REQUIRE(proc.read_string(mapping_end - 3) == "sdb");
+    REQUIRE_THROWS_AS(proc.read_string(mapping_end), error);
+    close(dev_null);
+}
+
+TEST_CASE("Batched reads report faults per request", "[memory]")
+{
+    auto dev_null = open("/dev/null", O_WRONLY);
+    auto target = target::launch("targets/large_buffer", dev_null);
+    auto& proc = target->get_process();
+    target->create_function_breakpoint("main").enable();
+    proc.resume();
+    proc.wait_on_signal();
+
+    auto& elf = target->get_main_elf();
+    auto buffer = file_addr{elf, elf.get_symbols_by_name("g_buffer").at(0)->st_value}.to_virt_addr();
+
+    std::vector<std::byte> data(3 * 0x1000);
+    for (std::size_t i = 0; i < data.size(); ++i) data[i] = std::byte(i * 13 + 5);
+    proc.write_memory(buffer, {data.data(), data.size()});
+
+    auto mapping_end = get_writable_mapping_end(proc.pid());
+    std::vector<process::memory_read_request> requests = {
+        {buffer + 0xffc, 8},
+        {mapping_end - 0x10, 0x20},
+        {buffer, data.size()},
+        {virt_addr{0}, 8},
+        {buffer + 7, 0},
+        {buffer + 0x2001, 1},
+    };
+    auto results = proc.read_memory_batch(requests);
+    REQUIRE(results.size() == requests.size());
+
+    REQUIRE(results[0].ok());
+    REQUIRE(std::equal(results[0].data.begin(), results[0].data.end(), data.begin() + 0xffc));
+
+    REQUIRE(!results[1].ok());
+    REQUIRE(results[1].error == EFAULT);
+    REQUIRE(results[1].data.size() == 0x10);
+
+    REQUIRE(results[2].ok());
+    REQUIRE(results[2].data == data);
+
+    REQUIRE(!results[3].ok());
+    REQUIRE(results[3].data.empty());
+
+    REQUIRE(results[4].ok());
+    REQUIRE(results[4].data.empty());
+
+    REQUIRE(results[5].ok());
+    REQUIRE(results[5].data.at(0) == data[0x2001]);
+    close(dev_null);
+}
+
+TEST_CASE("Memory cache serves repeated reads while stopped", "[memory]")
+{
+    auto dev_null = open("/dev/null", O_WRONLY);
+    auto target = target::launch("targets/large_buffer", dev_null);
+    auto& proc = target->get_process();
+    target->create_function_breakpoint("main").enable();
+    proc.resume();
+    proc.wait_on_signal();
+
+    auto& elf = target->get_main_elf();
+    auto buffer = file_addr{elf, elf.get_symbols_by_name("g_buffer").at(0)->st_value}.to_virt_addr();
+    auto page_aligned = virt_addr{(buffer.addr() + 0xfff) & ~0xfffull};
+
+    proc.set_memory_cache(true);
+    for (int i = 0; i < 1000; ++i) REQUIRE(proc.read_memory_as<std::uint64_t>(page_aligned + i * 8) == 0);
+    REQUIRE(proc.memory_cache_stats().misses == 2);
+    REQUIRE(proc.memory_cache_stats().hits == 998);
+
+    std::uint64_t value = 0xcafecafe;
+    proc.write_memory(page_aligned + 16, {reinterpret_cast<std::byte*>(&value), sizeof(value)});
+    REQUIRE(proc.read_memory_as<std::uint64_t>(page_aligned + 16) == 0xcafecafe);
+    REQUIRE(proc.memory_cache_stats().misses == 3);
+
+    auto reads_across_pages = proc.read_memory(page_aligned + 0xff8, 16);
+    REQUIRE(reads_across_pages.size() == 16);
+    REQUIRE(proc.memory_cache_stats().misses == 4);
+    REQUIRE(proc.memory_cache_stats().hits == 999);
+
+    proc.set_memory_cache(false);
+    proc.read_memory_as<std::uint64_t>(page_aligned);
+    REQUIRE(proc.memory_cache_stats().misses == 4);
+    REQUIRE(proc.memory_cache_stats().hits == 999);
+    close(dev_null);
+}
+
+TEST_CASE("Can write to read-only mappings", "[memory]")
+{
+    auto dev_null = open("/dev/null", O_WRONLY);
+    auto target = target::launch("targets/hello_sdb", dev_null);
+    auto& proc = target->get_process();
+    target->create_function_breakpoint("main").enable();
+    proc.resume();
+    proc.wait_on_signal();
+
+    // _start has already run and lives in a read-execute mapping
+    auto entry = virt_addr{proc.get_auxv()[AT_ENTRY]};
+    auto original = proc.read_memory(entry, 11);
+
+    proc.write_memory(entry, {as_bytes("Hello, sdb!"), 11});
+    REQUIRE(to_string_view(proc.read_memory(entry, 11)) == "Hello, sdb!");
+
+    proc.write_memory(entry, {original.data(), original.size()});
+    REQUIRE(proc.read_memory(entry, 11) == original);
+
+    proc.resume();
+    auto reason = proc.wait_on_signal();
+    REQUIRE(reason.reason == process_state::exited);
+    REQUIRE(reason.info == 0);
+    close(dev_null);
+}
+
 TEST_CASE("Hardware breakpoint evades memory checksums", "[breakpoint]")
 {
     bool close_on_exec = false;
@@ -576,6 +856,349 @@ TEST_CASE("Find main", "[dwarf]")
     REQUIRE(found);
 }
 
+TEST_CASE("Function containing address", "[dwarf]")
+{
+    auto path = "targets/multi_cu";
+    sdb::elf elf(path);
+    auto& dwarf = elf.get_dwarf();
+
+    for (auto name: {"main", "do_something"})
+    {
+        auto funcs = dwarf.find_functions(name);
+        REQUIRE(funcs.size() == 1);
+
+        auto low = funcs[0].low_pc();
+        auto high = funcs[0].high_pc();
+
+        auto at_low = dwarf.function_containing_address(low);
+        REQUIRE(at_low);
+        REQUIRE(at_low->position() == funcs[0].position());
+
+        auto at_last = dwarf.function_containing_address(high - 1);
+        REQUIRE(at_last);
+        REQUIRE(at_last->position() == funcs[0].position());
+    }
+
+    REQUIRE(!dwarf.function_containing_address(file_addr{elf, 0}));
+}
+
+TEST_CASE("Compile unit containing address", "[dwarf]")
+{
+    auto path = "targets/multi_cu";
+    sdb::elf elf(path);
+    auto& dwarf = elf.get_dwarf();
+
+    REQUIRE(dwarf.compile_units().size() == 2);
+    for (auto& cu: dwarf.compile_units())
+    {
+        auto root = cu->root();
+        REQUIRE(dwarf.compile_unit_containing_address(root.low_pc()) == cu.get());
+        REQUIRE(dwarf.compile_unit_containing_address(root.high_pc() - 1) == cu.get());
+    }
+
+    REQUIRE(dwarf.compile_unit_containing_address(file_addr{elf, 0}) == nullptr);
+}
+
+TEST_CASE("Malformed .debug_aranges falls back to the compile unit DIEs", "[dwarf]")
+{
+    auto path = std::filesystem::temp_directory_path() / ("sdb_aranges_" + std::to_string(getpid()));
+    std::uint64_t aranges_offset;
+    {
+        sdb::elf original("targets/multi_cu");
+        aranges_offset = original.get_section(".debug_aranges").value()->sh_offset;
+    }
+
+    // An oversized set length and a DWARF64 escape both have to stop the walk without reading past the section
+    for (std::uint32_t length: {0xffffff00u, 0xffffffffu})
+    {
+        std::filesystem::copy_file("targets/multi_cu", path, std::filesystem::copy_options::overwrite_existing);
+        {
+            std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(aranges_offset);
+            file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        }
+
+        sdb::elf elf(path);
+        auto& dwarf = elf.get_dwarf();
+        for (auto& cu: dwarf.compile_units())
+        {
+            auto root = cu->root();
+            REQUIRE(dwarf.compile_unit_containing_address(root.low_pc()) == cu.get());
+            REQUIRE(dwarf.compile_unit_containing_address(root.high_pc() - 1) == cu.get());
+        }
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Compile unit ranges are built once across threads", "[dwarf]")
+{
+    sdb::elf elf("targets/large_dwarf");
+    auto& dwarf = elf.get_dwarf();
+
+    std::vector<sdb::file_addr> addresses;
+    for (auto& cu: dwarf.compile_units())
+    {
+        auto root = cu->root();
+        if (root.contains(DW_AT_low_pc)) addresses.push_back(root.low_pc());
+    }
+
+    std::vector<std::vector<const sdb::compile_unit*>> results(4);
+    std::vector<std::thread> threads;
+    for (auto& result: results)
+    {
+        threads.emplace_back([&] {
+            for (auto address: addresses) result.push_back(dwarf.compile_unit_containing_address(address));
+        });
+    }
+    for (auto& thread: threads) thread.join();
+
+    for (auto& result: results)
+    {
+        REQUIRE(result.size() == addresses.size());
+        for (std::size_t i = 0; i < result.size(); ++i) REQUIRE(result[i] == dwarf.compile_unit_containing_address(addresses[i]));
+        REQUIRE(std::find(result.begin(), result.end(), nullptr) == result.end());
+    }
+}
+
+#ifdef SDB_HAVE_GOLD
+TEST_CASE("Accelerated name lookup", "[dwarf]")
+{
+    sdb::elf plain("targets/multi_cu");
+    sdb::elf accelerated("targets/multi_cu_gdb_index");
+    REQUIRE(accelerated.get_section(".gdb_index").has_value());
+
+    auto& dwarf = accelerated.get_dwarf();
+    std::vector<std::string> names{"main", "do_something"};
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+        auto expected = plain.get_dwarf().find_functions(names[i]);
+        auto found = dwarf.find_functions(names[i]);
+        REQUIRE(found.size() == 1);
+        REQUIRE(found.size() == expected.size());
+        REQUIRE(found[0].name() == expected[0].name());
+        REQUIRE(found[0].cu() == dwarf.compile_units()[i].get());
+    }
+
+    REQUIRE(dwarf.find_functions("not_a_function").empty());
+    REQUIRE(!dwarf.find_global_variable("main").has_value());
+}
+
+TEST_CASE("Accelerated lookups of inlined functions match the full index", "[dwarf]")
+{
+    sdb::elf plain("targets/step");
+    sdb::elf accelerated("targets/step_gdb_index");
+    REQUIRE(accelerated.get_section(".gdb_index").has_value());
+
+    auto find = [](sdb::elf& elf, std::string name)
+    {
+        auto debug_info = elf.get_section_contents(".debug_info");
+        std::set<std::pair<std::uint64_t, std::uint64_t>> found;
+        for (auto& func: elf.get_dwarf().find_functions(name))
+        {
+            found.emplace(func.position() - debug_info.begin(), func.abbrev_entry()->tag);
+        }
+        return found;
+    };
+
+    for (auto name: {"main", "find_happiness", "pet_cat", "scratch_ears"})
+    {
+        auto expected = find(plain, name);
+        REQUIRE(!expected.empty());
+        REQUIRE(find(accelerated, name) == expected);
+    }
+
+    REQUIRE(find(accelerated, "scratch_ears").begin()->second == DW_TAG_inlined_subroutine);
+}
+#endif
+
+#ifdef SDB_HAVE_CLANG
+TEST_CASE("Name lookup through .debug_names", "[dwarf]")
+{
+    sdb::elf plain("targets/multi_cu");
+    sdb::elf accelerated("targets/multi_cu_debug_names");
+    REQUIRE(accelerated.get_section(".debug_names").has_value());
+
+    auto& dwarf = accelerated.get_dwarf();
+    std::vector<std::string> names{"main", "do_something"};
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+        auto expected = plain.get_dwarf().find_functions(names[i]);
+        auto found = dwarf.find_functions(names[i]);
+        REQUIRE(found.size() == 1);
+        REQUIRE(found.size() == expected.size());
+        REQUIRE(found[0].name() == expected[0].name());
+        REQUIRE(found[0].cu() == dwarf.compile_units()[i].get());
+        REQUIRE(found[0].abbrev_entry()->tag == DW_TAG_subprogram);
+    }
+
+    REQUIRE(dwarf.find_functions("not_a_function").empty());
+    REQUIRE(!dwarf.find_global_variable("main").has_value());
+}
+#endif
+
+TEST_CASE("Index cache round trip", "[dwarf]")
+{
+    auto path = "targets/multi_cu";
+    auto cache_directory = std::filesystem::temp_directory_path() / ("sdb_index_cache_" + std::to_string(getpid()));
+    sdb::index_cache::set_directory(cache_directory);
+
+    auto summarize = [](sdb::elf& elf)
+    {
+        auto& dwarf = elf.get_dwarf();
+        std::vector<std::uint64_t> summary;
+        for (auto& func: dwarf.find_functions("main")) summary.push_back(func.low_pc().addr());
+
+        auto main = dwarf.find_functions("main").at(0);
+        summary.push_back(dwarf.function_containing_address(main.low_pc())->low_pc().addr());
+        summary.push_back(dwarf.compile_unit_containing_address(main.low_pc())->root().low_pc().addr());
+
+        auto& lines = main.cu()->lines();
+        auto entry = lines.get_entry_by_address(main.low_pc());
+        summary.push_back(entry->line);
+        summary.push_back(std::distance(lines.begin(), lines.end()));
+        summary.push_back(elf.get_symbols_by_name("main").size());
+        return summary;
+    };
+
+    std::vector<std::uint64_t> fresh;
+    {
+        sdb::elf elf(path);
+        fresh = summarize(elf);
+    }
+
+    REQUIRE(std::filesystem::exists(cache_directory));
+    REQUIRE(!std::filesystem::is_empty(cache_directory));
+
+    {
+        sdb::elf elf(path);
+        REQUIRE(summarize(elf) == fresh);
+    }
+
+    sdb::index_cache::set_directory(std::nullopt);
+    std::filesystem::remove_all(cache_directory);
+}
+
+TEST_CASE("Index cache is written only once indexed and rejects bad records", "[dwarf]")
+{
+    auto path = "targets/multi_cu";
+    auto cache_directory = std::filesystem::temp_directory_path() / ("sdb_index_cache_" + std::to_string(getpid()));
+    sdb::index_cache::set_directory(cache_directory);
+
+    {
+        sdb::elf elf(path);
+        REQUIRE(elf.get_dwarf().compile_units().size() == 2);
+    }
+    REQUIRE((!std::filesystem::exists(cache_directory) or std::filesystem::is_empty(cache_directory)));
+
+    auto main_line = [&]
+    {
+        sdb::elf elf(path);
+        auto main = elf.get_dwarf().find_functions("main").at(0);
+        auto entry = elf.get_dwarf().line_entry_at_address(main.low_pc());
+        return std::make_pair(std::string(*elf.get_dwarf().function_containing_address(main.low_pc())->name()), entry->line);
+    };
+
+    auto fresh = main_line();
+    auto cache_file = std::filesystem::directory_iterator(cache_directory)->path();
+
+    // Keep the header so only the records are out of range
+    constexpr std::size_t header_size = 200;
+    auto size = std::filesystem::file_size(cache_file);
+    {
+        std::fstream file(cache_file, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(header_size);
+        std::string garbage(size - header_size, '\xff');
+        file.write(garbage.data(), garbage.size());
+    }
+
+    REQUIRE(main_line() == fresh);
+
+    std::ifstream file(cache_file, std::ios::binary);
+    std::string contents(std::istreambuf_iterator<char>(file), {});
+    REQUIRE(contents.find(std::string(64, '\xff')) == std::string::npos);
+
+    sdb::index_cache::set_directory(std::nullopt);
+    std::filesystem::remove_all(cache_directory);
+}
+
+TEST_CASE("Abbrev table lookup", "[dwarf]")
+{
+    auto path = "targets/multi_cu";
+    sdb::elf elf(path);
+    auto& dwarf = elf.get_dwarf();
+
+    for (auto& cu: dwarf.compile_units())
+    {
+        auto& table = cu->abbrev_table();
+        REQUIRE(table.find(0) == nullptr);
+
+        auto root = cu->root();
+        REQUIRE(table.find(root.abbrev_entry()->code) == root.abbrev_entry());
+        for (auto child: root.children())
+        {
+            REQUIRE(&table.at(child.abbrev_entry()->code) == child.abbrev_entry());
+        }
+    }
+
+    REQUIRE_THROWS_AS(dwarf.compile_units()[0]->abbrev_table().at(0), sdb::error);
+}
+
+TEST_CASE("DIE attribute locations", "[dwarf]")
+{
+    STATIC_REQUIRE(std::is_trivially_copyable_v<sdb::die>);
+
+    auto path = "targets/hello_sdb";
+    sdb::elf elf(path);
+    auto& dwarf = elf.get_dwarf();
+
+    auto main = dwarf.find_functions("main").at(0);
+    REQUIRE(main.name() == "main");
+    REQUIRE(main[DW_AT_decl_line].as_int() > 0);
+    REQUIRE(main.low_pc() < main.high_pc());
+
+    std::function<void(const sdb::die&)> check_strings = [&](const sdb::die& d)
+    {
+        for (auto& spec: d.abbrev_entry()->attr_specs)
+        {
+            if ((spec.form != DW_FORM_strp) and (spec.form != DW_FORM_string)) continue;
+            auto str = d[spec.attr].as_string();
+            REQUIRE(std::all_of(str.begin(), str.end(), [](char c) { return std::isprint(static_cast<unsigned char>(c)); }));
+        }
+
+        for (auto& child: d.children()) check_strings(child);
+    };
+
+    for (auto& cu: dwarf.compile_units()) check_strings(cu->root());
+}
+
+TEST_CASE("Line entries by line", "[dwarf]")
+{
+    auto path = "targets/multi_cu";
+    sdb::elf elf(path);
+    auto& dwarf = elf.get_dwarf();
+
+    for (auto file: {"multi_cu_main.cpp", "multi_cu_other.cpp", "test/targets/multi_cu_main.cpp"})
+    {
+        for (std::size_t line = 1; line < 10; ++line)
+        {
+            std::vector<sdb::file_addr> expected;
+            for (auto& cu: dwarf.compile_units())
+            {
+                for (auto& entry: cu->lines().get_entries_by_line(file, line)) expected.push_back(entry->address);
+            }
+
+            std::vector<sdb::file_addr> found;
+            for (auto& entry: dwarf.get_line_entries_by_line(file, line)) found.push_back(entry->address);
+
+            REQUIRE(found == expected);
+        }
+    }
+
+    REQUIRE(!dwarf.get_line_entries_by_line("multi_cu_main.cpp", 5).empty());
+    REQUIRE(dwarf.get_line_entries_by_line("other/multi_cu_main.cpp", 5).empty());
+}
+
 TEST_CASE("Range list", "[dwarf]")
 {
     auto path = "targets/multi_cu";
@@ -640,6 +1263,82 @@ TEST_CASE("Line table", "[dwarf]")
     REQUIRE(it == cu->lines().end());
 }
 
+TEST_CASE("Line table address lookups match a linear scan", "[dwarf]")
+{
+    auto linear_lookup = [](const sdb::line_table& lines, sdb::file_addr address)
+    {
+        auto prev = lines.begin();
+        if (prev == lines.end()) return lines.end();
+
+        for (auto it = std::next(prev); it != lines.end(); prev = it++)
+        {
+            if ((prev->address <= address) and (it->address > address) and !prev->end_sequence) return prev;
+        }
+        return lines.end();
+    };
+
+    for (auto path: {"targets/hello_sdb", "targets/multi_cu"})
+    {
+        sdb::elf elf(path);
+        for (auto& cu: elf.get_dwarf().compile_units())
+        {
+            auto& lines = cu->lines();
+            for (auto& entry: lines)
+            {
+                for (auto address: {entry.address - 1, entry.address, entry.address + 1})
+                {
+                    auto found = lines.get_entry_by_address(address);
+                    REQUIRE(found == linear_lookup(lines, address));
+                    if (found == lines.end()) continue;
+
+                    auto next = std::next(found);
+                    REQUIRE(found->address <= address);
+                    REQUIRE(((next == lines.end()) or (next->address > address) or next->end_sequence));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Malformed line programs are not cached as empty tables", "[dwarf]")
+{
+    sdb::elf elf("targets/hello_sdb");
+    auto& cu = elf.get_dwarf().compile_units()[0];
+
+    // One good row, then an unknown extended opcode
+    std::vector<std::byte> program{std::byte{DW_LNS_copy}, std::byte{0}, std::byte{1}, std::byte{0x7f}};
+    sdb::line_table lines({program.data(), program.size()}, cu.get(), true, -5, 14, 13, {}, {});
+
+    REQUIRE_THROWS_AS(lines.begin(), error);
+    REQUIRE_THROWS_AS(lines.begin(), error);
+    REQUIRE_THROWS_AS(lines.get_entry_by_address(sdb::file_addr{elf, 0}), error);
+}
+
+TEST_CASE("Line tables decode once when first used from several threads", "[dwarf]")
+{
+    auto count_rows = [](const sdb::dwarf& dwarf)
+    {
+        std::vector<std::size_t> counts;
+        for (auto& cu: dwarf.compile_units())
+        {
+            auto& lines = cu->lines();
+            counts.push_back(std::distance(lines.begin(), lines.end()));
+        }
+        return counts;
+    };
+
+    sdb::elf serial_elf("targets/large_dwarf");
+    auto expected = count_rows(serial_elf.get_dwarf());
+
+    sdb::elf elf("targets/large_dwarf");
+    std::vector<std::vector<std::size_t>> results(4);
+    std::vector<std::thread> threads;
+    for (auto& result: results) threads.emplace_back([&] { result = count_rows(elf.get_dwarf()); });
+    for (auto& thread: threads) thread.join();
+
+    for (auto& result: results) REQUIRE(result == expected);
+}
+
 TEST_CASE("Source-level breakpoints", "[breakpoint]")
 {
     auto dev_null = open("/dev/null", O_WRONLY);
@@ -681,6 +1380,107 @@ TEST_CASE("Source-level breakpoints", "[breakpoint]")
     close(dev_null);
 }
 
+TEST_CASE("Displaced stepping matches stepping in place", "[breakpoint]")
+{
+    auto dev_null = open("/dev/null", O_WRONLY);
+
+    auto capture = [](process& proc)
+    {
+        auto& regs = proc.get_registers();
+        auto rsp = regs.read_by_id_as<std::uint64_t>(register_id::rsp);
+        return std::vector<std::uint64_t>{
+            regs.read_by_id_as<std::uint64_t>(register_id::rip), rsp,
+            regs.read_by_id_as<std::uint64_t>(register_id::rax),
+            regs.read_by_id_as<std::uint64_t>(register_id::rdi),
+            proc.read_memory_as<std::uint64_t>(virt_addr{rsp})
+        };
+    };
+
+    // main's body, the PLT stub for puts and the lazy binding trampoline cover
+    // RIP-relative operands, relative calls and jumps, and indirect jumps
+    constexpr int n_instructions = 8;
+    std::vector<std::vector<std::uint64_t>> expected;
+    {
+        auto target = target::launch("targets/hello_sdb", dev_null);
+        auto& proc = target->get_process();
+        proc.set_displaced_stepping(false);
+        target->create_function_breakpoint("main").enable();
+        proc.resume();
+        proc.wait_on_signal();
+
+        for (int i = 0; i < n_instructions; ++i)
+        {
+            expected.push_back(capture(proc));
+            proc.step_instruction();
+        }
+    }
+
+    {
+        auto target = target::launch("targets/hello_sdb", dev_null);
+        auto& proc = target->get_process();
+        target->create_function_breakpoint("main").enable();
+        proc.resume();
+        proc.wait_on_signal();
+
+        for (int i = 1; i < n_instructions; ++i) proc.create_breakpoint_site(virt_addr{expected[i][0]}).enable();
+
+        for (int i = 0; i < n_instructions; ++i)
+        {
+            REQUIRE(capture(proc) == expected[i]);
+            proc.step_instruction();
+        }
+    }
+
+    auto target = target::launch("targets/hello_sdb", dev_null);
+    auto& proc = target->get_process();
+    REQUIRE(proc.displaced_stepping());
+    target->create_function_breakpoint("main").enable();
+    proc.resume();
+    proc.wait_on_signal();
+
+    for (int i = 1; i < n_instructions; ++i) proc.create_breakpoint_site(virt_addr{expected[i][0]}).enable();
+
+    stop_reason reason;
+    for (int i = 0; i < n_instructions; ++i)
+    {
+        REQUIRE(capture(proc) == expected[i]);
+        proc.resume();
+        reason = proc.wait_on_signal();
+    }
+
+    REQUIRE(reason.reason == process_state::exited);
+    REQUIRE(reason.info == 0);
+    close(dev_null);
+}
+
+TEST_CASE("Signals that arrive while stepping over a breakpoint are reported", "[breakpoint]")
+{
+    for (auto displaced: {true, false})
+    {
+        auto dev_null = open("/dev/null", O_WRONLY);
+        auto target = target::launch("targets/hello_sdb", dev_null);
+        auto& proc = target->get_process();
+        proc.set_displaced_stepping(displaced);
+        target->create_function_breakpoint("main").enable();
+        proc.resume();
+        proc.wait_on_signal();
+        auto pc = proc.get_pc();
+
+        kill(proc.pid(), SIGUSR1);
+        proc.resume();
+        auto reason = proc.wait_on_signal();
+        REQUIRE(reason.reason == process_state::stopped);
+        REQUIRE(reason.info == SIGUSR1);
+        REQUIRE(proc.get_pc() == pc);
+
+        proc.resume();
+        reason = proc.wait_on_signal();
+        REQUIRE(reason.reason == process_state::exited);
+        REQUIRE(reason.info == 0);
+        close(dev_null);
+    }
+}
+
 TEST_CASE("Source-level stepping", "[target]")
 {
     auto dev_null = open("/dev/null", O_WRONLY);
@@ -740,6 +1540,204 @@ TEST_CASE("Stack unwinding", "[unwind]")
     for (auto i = 0; i < frames.size(); i++) REQUIRE(frames[i].func_die.name().value() == expected_names[i]);
 }
 
+TEST_CASE("Unwinding reuses cached CFI rows", "[unwind]")
+{
+    auto target = target::launch("targets/step");
+    auto& proc = target->get_process();
+    auto& cfi = target->get_main_elf().get_dwarf().cfi();
+    target->create_function_breakpoint("scratch_ears").enable();
+    proc.resume();
+    proc.wait_on_signal();
+    target->step_in();
+    target->step_in();
+
+    auto first = target->get_stack().frames();
+    std::vector<stack_frame> frames(first.begin(), first.end());
+    auto cached_unwinds = cfi.cached_unwinds();
+
+    proc.resume();
+    proc.wait_on_signal();
+    target->step_in();
+    target->step_in();
+
+    auto second = target->get_stack().frames();
+    REQUIRE(cfi.cached_unwinds() > cached_unwinds);
+    REQUIRE(second.size() == frames.size());
+    for (auto i = 0; i < second.size(); i++)
+    {
+        REQUIRE(second[i].func_die.name().value() == frames[i].func_die.name().value());
+        REQUIRE(second[i].regs.read_by_id_as<std::uint64_t>(register_id::rsp) == frames[i].regs.read_by_id_as<std::uint64_t>(register_id::rsp));
+    }
+}
+
+TEST_CASE("Frame pointer unwinding matches CFI unwinding", "[unwind]")
+{
+    auto target = target::launch("targets/deep_recursion");
+    auto& proc = target->get_process();
+    target->create_function_breakpoint("bottom").enable();
+    proc.resume();
+    proc.wait_on_signal();
+
+    auto precise = std::vector<stack_frame>(target->get_stack().frames().begin(), target->get_stack().frames().end());
+    REQUIRE(precise.size() == 503);
+
+    target->set_unwind_mode(unwind_mode::frame_pointer);
+    target->get_stack().unwind();
+    auto fast = target->get_stack().frames();
+
+    REQUIRE(fast.size() == precise.size());
+    for (std::size_t i = 0; i < fast.size(); ++i)
+    {
+        REQUIRE(fast[i].func_die.name() == precise[i].func_die.name());
+        REQUIRE(fast[i].backtrace_report_address == precise[i].backtrace_report_address);
+        REQUIRE(fast[i].regs.cfa() == precise[i].regs.cfa());
+    }
+}
+
+TEST_CASE("Stack snapshot is invalidated by writes", "[unwind]")
+{
+    auto target = target::launch("targets/step");
+    auto& proc = target->get_process();
+    target->create_function_breakpoint("find_happiness").enable();
+    proc.resume();
+    proc.wait_on_signal();
+
+    auto rsp = virt_addr{proc.get_registers().read_by_id_as<std::uint64_t>(register_id::rsp)};
+    auto before = proc.read_memory(rsp, 0x100);
+    target->get_stack().unwind();
+    REQUIRE(proc.read_memory(rsp, 0x100) == before);
+
+    auto original = proc.read_memory_as<std::uint64_t>(rsp);
+    proc.write_memory(rsp, to_byte_span(original + 1));
+    REQUIRE(proc.read_memory_as<std::uint64_t>(rsp) == original + 1);
+
+    target->get_stack().unwind();
+    proc.write_memory(rsp, to_byte_span(original));
+    REQUIRE(proc.read_memory_as<std::uint64_t>(rsp) == original);
+}
+
+TEST_CASE("Profiler folds sampled stacks", "[profile]")
+{
+    auto target = target::launch("targets/run_endlessly");
+    auto& proc = target->get_process();
+    auto& bp = target->create_function_breakpoint("main");
+    bp.enable();
+    proc.resume();
+    proc.wait_on_signal();
+    bp.disable();
+    proc.resume();
+
+    profiler prof(*target, 4);
+    for (int i = 0; i < 10; ++i) REQUIRE(prof.sample());
+
+    REQUIRE(prof.stats().n_ticks == 10);
+    REQUIRE(prof.stats().n_samples == 10);
+    REQUIRE(prof.stats().max_stop_time.count() > 0);
+    REQUIRE(prof.folded_stacks() == "run_endlessly`main 10\n");
+}
+
+TEST_CASE("Profiler run is driven by the event loop", "[profile]")
+{
+    auto target = target::launch("targets/run_endlessly");
+    auto& proc = target->get_process();
+    auto& bp = target->create_function_breakpoint("main");
+    bp.enable();
+    proc.resume();
+    proc.wait_on_signal();
+    bp.disable();
+
+    profiler prof(*target);
+    prof.run(std::chrono::milliseconds(2), std::chrono::milliseconds(50));
+
+    REQUIRE(prof.stats().n_ticks > 0);
+    REQUIRE(prof.stats().n_samples == prof.stats().n_ticks);
+    REQUIRE(proc.state() == process_state::running);
+}
+
+TEST_CASE("Event loop multiplexes timers and process events", "[event_loop]")
+{
+    auto proc = process::launch("targets/end_immediately");
+
+    event_loop loop;
+    std::optional<stop_reason> reason;
+    loop.watch(*proc, [&](const stop_reason& r) {
+        reason = r;
+        loop.stop();
+    });
+
+    int ticks = 0;
+    auto timer = loop.add_timer(std::chrono::milliseconds(1), [&] {
+        if (++ticks == 3) proc->resume();
+    });
+    loop.run();
+    loop.remove_timer(timer);
+
+    // The timer keeps ticking while the exit is on its way
+    REQUIRE(ticks >= 3);
+    REQUIRE(reason);
+    REQUIRE(reason->reason == process_state::exited);
+    REQUIRE(reason->info == 0);
+    REQUIRE(proc->state() == process_state::exited);
+    REQUIRE(loop.run_once(std::chrono::milliseconds(0)) == 0);
+}
+
+TEST_CASE("Event loop drains filtered events without recursing", "[event_loop]")
+{
+    auto dev_null = open("/dev/null", O_WRONLY);
+    auto proc = process::launch("targets/hello_sdb", true, dev_null);
+
+    auto exit_group_syscall = syscall_name_to_id("exit_group");
+    proc->set_syscall_catch_policy(syscall_catch_policy::catch_some({exit_group_syscall}));
+
+    event_loop loop;
+    std::vector<stop_reason> reasons;
+    loop.watch(*proc, [&](const stop_reason& r) {
+        reasons.push_back(r);
+        loop.stop();
+    });
+
+    proc->resume();
+    loop.run();
+
+    REQUIRE(reasons.size() == 1);
+    REQUIRE(reasons[0].reason == process_state::stopped);
+    REQUIRE(reasons[0].trap_reason == trap_type::syscall);
+    REQUIRE(reasons[0].syscall_info->id == exit_group_syscall);
+    REQUIRE(reasons[0].syscall_info->entry == true);
+
+    close(dev_null);
+}
+
+TEST_CASE("Event loop keeps the events of several processes apart", "[event_loop]")
+{
+    auto dev_null = open("/dev/null", O_WRONLY);
+    auto second = process::launch("targets/multi_threaded", true, dev_null);
+    auto first = process::launch("targets/hello_sdb", true, dev_null);
+
+    event_loop loop;
+    std::vector<stop_reason> first_reasons;
+    std::vector<stop_reason> second_reasons;
+    loop.watch(*first, [&](const stop_reason& r) { first_reasons.push_back(r); });
+    loop.watch(*second, [&](const stop_reason& r) { second_reasons.push_back(r); });
+
+    // Let both have events waiting before the loop first polls
+    second->resume();
+    first->resume();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    while ((first->state() != process_state::exited) or (second->state() != process_state::exited))
+    {
+        loop.run_once(std::chrono::milliseconds(1000));
+    }
+
+    REQUIRE(first_reasons.size() == 1);
+    REQUIRE(first_reasons[0].tid == first->pid());
+    REQUIRE(first_reasons[0].reason == process_state::exited);
+    REQUIRE(second_reasons.size() == 1);
+    REQUIRE(second_reasons[0].tid == second->pid());
+    REQUIRE(second_reasons[0].reason == process_state::exited);
+    close(dev_null);
+}
+
 TEST_CASE("Shared library tracing works", "[dynlib]")
 {
     auto dev_null = open("/dev/null", O_WRONLY);
@@ -785,6 +1783,117 @@ TEST_CASE("Multithreading works", "[threads]")
     close(dev_null);
 }
 
+TEST_CASE("Non-stop mode only stops the thread that trapped", "[threads]")
+{
+    auto dev_null = open("/dev/null", O_WRONLY);
+    auto target = target::launch("targets/multi_threaded", dev_null);
+    auto& proc = target->get_process();
+    target->set_non_stop(true);
+
+    target->create_function_breakpoint("say_hi").enable();
+
+    std::set<pid_t> tids;
+    proc.resume();
+    auto reason = proc.wait_on_signal();
+    while (reason.reason == process_state::stopped)
+    {
+        REQUIRE(reason.is_breakpoint());
+        REQUIRE(reason.tid != proc.pid());
+        REQUIRE(proc.thread_states().at(proc.pid()).state == process_state::running);
+        REQUIRE(proc.thread_states().at(reason.tid).state == process_state::stopped);
+        REQUIRE(proc.state() == process_state::stopped);
+        tids.insert(reason.tid);
+
+        proc.resume(reason.tid);
+        reason = proc.wait_on_signal();
+    }
+
+    REQUIRE(tids.size() == 10);
+    REQUIRE(reason.reason == process_state::exited);
+    close(dev_null);
+}
+
+TEST_CASE("Non-stop mode reports events that race a pause", "[threads]")
+{
+    auto dev_null = open("/dev/null", O_WRONLY);
+    auto target = target::launch("targets/racing_threads", dev_null);
+    auto& proc = target->get_process();
+    target->set_non_stop(true);
+
+    auto& bp = target->create_function_breakpoint("race");
+    bp.enable();
+    virt_addr bp_address;
+    bp.breakpoint_sites().for_each([&](auto& site) { bp_address = site.address(); });
+
+    std::set<pid_t> tids;
+    proc.resume();
+    auto reason = proc.wait_on_signal();
+    REQUIRE(reason.is_breakpoint());
+    tids.insert(reason.tid);
+
+    // Let the other threads trap without collecting them, so that pausing them
+    // for the watchpoint finds breakpoint hits instead of interrupts
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    auto& watch = proc.create_watchpoint(virt_addr{bp_address.addr() & ~7ull}, stoppoint_mode::write, 8);
+    watch.enable();
+
+    std::size_t n_deferred = 0;
+    for (auto& [tid, thread]: proc.thread_states())
+    {
+        if ((tid == reason.tid) or (tid == proc.pid()) or (thread.state != process_state::stopped)) continue;
+        REQUIRE(proc.get_pc(tid) == bp_address);
+        ++n_deferred;
+    }
+    REQUIRE(n_deferred > 0);
+
+    proc.resume_all_threads();
+    reason = proc.wait_on_signal();
+    while (reason.reason == process_state::stopped)
+    {
+        REQUIRE(reason.is_breakpoint());
+        REQUIRE(proc.get_pc(reason.tid) == bp_address);
+        tids.insert(reason.tid);
+
+        proc.resume(reason.tid);
+        reason = proc.wait_on_signal();
+    }
+
+    REQUIRE(tids.size() == 10);
+    REQUIRE(reason.reason == process_state::exited);
+    close(dev_null);
+}
+
+TEST_CASE("Stack reads see writes from running sibling threads", "[threads]")
+{
+    auto target = target::launch("targets/stack_writer");
+    auto& proc = target->get_process();
+    target->set_non_stop(true);
+    target->create_function_breakpoint("checkpoint").enable();
+
+    proc.resume();
+    auto reason = proc.wait_on_signal();
+    REQUIRE(reason.is_breakpoint());
+
+    auto& elf = target->get_main_elf();
+    auto g_counter = file_addr{elf, elf.get_symbols_by_name("g_counter").at(0)->st_value}.to_virt_addr();
+    auto counter = virt_addr{proc.read_memory_as<std::uint64_t>(g_counter)};
+
+    // Unwinding would snapshot the stack that the writer thread keeps changing
+    REQUIRE(target->get_stack(reason.tid).frames().size() >= 2);
+    auto first = proc.read_memory_as<std::uint64_t>(counter);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE(proc.read_memory_as<std::uint64_t>(counter) > first);
+
+    proc.resume(reason.tid);
+    reason = proc.wait_on_signal();
+    while (reason.reason == process_state::stopped)
+    {
+        proc.resume(reason.tid);
+        reason = proc.wait_on_signal();
+    }
+    REQUIRE(reason.reason == process_state::exited);
+}
+
 TEST_CASE("Can read global integer variable", "[variable]")
 {
     auto target = target::launch("targets/global_variable");
@@ -22,6 +22,8 @@
 #include <libsdb/syscalls.hpp>
 #include <libsdb/target.hpp>
 #include <libsdb/type.hpp>
+#include <libsdb/index_cache.hpp>
+#include <libsdb/profiler.hpp>
 
 namespace 
 {
@@ -29,7 +31,7 @@ namespace
 
     void handle_sigint(int)
     {
-        kill(g_sdb_process->pid(), SIGSTOP);
+        ptrace(PTRACE_INTERRUPT, g_sdb_process->pid(), nullptr, nullptr);
     }
 
     void thread_lifecycle_callback(const sdb::stop_reason& reason)
@@ -147,6 +149,11 @@ namespace
             return " (single step)";
         }
 
+        if (reason.trap_reason == sdb::trap_type::interrupt)
+        {
+            return " (interrupted)";
+        }
+
         if (reason.trap_reason == sdb::trap_type::syscall)
         {
             const auto& info = *reason.syscall_info;
@@ -373,6 +380,8 @@ namespace
             std::cerr << R"(Available options:
     list
     select <thread ID>
+    continue [thread ID]
+    non-stop <on|off>
 )";
 
         } else if (is_prefix(args[1], "variable")) {
@@ -912,6 +921,38 @@ namespace
             }
 
             target.get_process().set_current_thread(*tid);
+
+        } else if (is_prefix(args[1], "continue")) {
+
+            auto& process = target.get_process();
+            auto tid = (args.size() > 2) ? sdb::to_integral<pid_t>(args[2]) : process.current_thread();
+            if (!tid or !target.threads().count(*tid))
+            {
+                std::cerr << "Invalid thread id\n";
+                return;
+            }
+
+            if (target.threads().at(*tid).state->state != sdb::process_state::stopped)
+            {
+                std::cerr << "Thread is not stopped\n";
+                return;
+            }
+
+            process.resume(*tid);
+            auto reason = process.wait_on_signal();
+            handle_stop(target, reason);
+
+        } else if (is_prefix(args[1], "non-stop")) {
+
+            if (args.size() != 3)
+            {
+                print_help({"help","thread"});
+                return;
+            }
+
+            if (args[2] == "on") target.set_non_stop(true);
+            else if (args[2] == "off") target.set_non_stop(false);
+            else print_help({"help","thread"});
         }
     }
 
@@ -1135,6 +1176,43 @@ namespace
         }
     }
 
+    int profile(int argc, const char** argv)
+    {
+        std::optional<pid_t> pid;
+        double seconds = 10;
+        double frequency = 99;
+
+        for (int i = 2; i + 1 < argc; i += 2)
+        {
+            auto flag = std::string_view(argv[i]);
+            if (flag == "-p") pid = std::atoi(argv[i + 1]);
+            else if (flag == "-d") seconds = std::atof(argv[i + 1]);
+            else if (flag == "-F") frequency = std::atof(argv[i + 1]);
+        }
+
+        if (!pid or (seconds <= 0) or (frequency <= 0))
+        {
+            std::cerr << "Usage: sdb profile -p <pid> [-d <seconds>] [-F <frequency>]\n";
+            return -1;
+        }
+
+        auto target = sdb::target::attach(*pid);
+        sdb::profiler prof(*target);
+
+        auto interval = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1 / frequency));
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(seconds));
+        prof.run(interval, duration);
+
+        fmt::print("{}", prof.folded_stacks());
+
+        auto& stats = prof.stats();
+        auto mean_us = stats.n_ticks ? stats.total_stop_time.count() / 1000.0 / stats.n_ticks : 0.0;
+        std::cerr << fmt::format("{} samples in {} ticks, mean stop {:.1f} us, max stop {:.1f} us\n",
+            stats.n_samples, stats.n_ticks, mean_us, stats.max_stop_time.count() / 1000.0);
+
+        return 0;
+    }
+
     void main_loop(std::unique_ptr<sdb::target>& target)
     {
         char* line = nullptr;
@@ -1180,8 +1258,15 @@ int main (int argc, const char** argv)
         return -1;
     }
 
+    if (auto cache_directory = std::getenv("SDB_INDEX_CACHE_DIR"))
+    {
+        sdb::index_cache::set_directory(std::filesystem::path(cache_directory));
+    }
+
     try
     {
+        if (argv[1] == std::string_view("profile")) return profile(argc, argv);
+
         auto target = attach(argc, argv);
         g_sdb_process = &target->get_process();
         signal(SIGINT, handle_sigint);